@@ -0,0 +1,17 @@
+#pragma once
+
+#include "pxr/base/tf/getenv.h"
+
+#include <iostream>
+
+// Trace of the queries Hydra makes to a SceneDelegate. It is off by default
+// because a line per Get() dominates the frame on anything but a toy scene;
+// set IETUTORIALS_DELEGATE_LOG=1 to turn it on.
+inline bool DelegateLogEnabled()
+{
+	static const bool enabled = pxr::TfGetenvBool("IETUTORIALS_DELEGATE_LOG", false);
+	return enabled;
+}
+
+// DELEGATE_LOG << "[" << id.GetString() << "][Extent]" << std::endl;
+#define DELEGATE_LOG if (!DelegateLogEnabled()) {} else std::cout
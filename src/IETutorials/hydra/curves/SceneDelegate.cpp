@@ -1,4 +1,5 @@
 #include "SceneDelegate.h"
+#include "DelegateLog.h"
 
 #include "pxr/imaging/hd/camera.h"
 #include "pxr/imaging/cameraUtil/conformWindow.h"
@@ -10,39 +11,68 @@
 #include "pxr/base/gf/frustum.h"
 #include "pxr/base/vt/array.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 
-SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const &delegateID)
- : pxr::HdSceneDelegate(parentIndex, delegateID)
+namespace
+{
+	// A stable rank in [0, 1) for curve c. The ranks are well spread, so the
+	// curves below any threshold are spread evenly over the grid.
+	inline float CurveRank(int c)
+	{
+		uint32_t h = uint32_t(c);
+		h ^= h >> 16;
+		h *= 0x7feb352dU;
+		h ^= h >> 15;
+		h *= 0x846ca68bU;
+		h ^= h >> 16;
+		return (h >> 8) * (1.0f / 16777216.0f);
+	}
+}
+
+
+SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const &delegateID,
+							 int curvesPerSide, float cameraDistance)
+ : pxr::HdSceneDelegate(parentIndex, delegateID),
+  arraySize(std::max(curvesPerSide, 1)),
+  currentLod(0),
+  viewportHeight(512.0f),
+  rotation(0.0f)
 {
 	cameraPath = pxr::SdfPath("/camera");
 	GetRenderIndex().InsertSprim(pxr::HdPrimTypeTokens->camera, this, cameraPath);
 	pxr::GfFrustum frustum;
-	frustum.SetPosition(pxr::GfVec3d(0, 0, 3));
+	frustum.SetPosition(pxr::GfVec3d(0, 0, cameraDistance));
 	SetCamera(frustum.ComputeViewMatrix(), frustum.ComputeProjectionMatrix());
 
 	GetRenderIndex().InsertRprim(pxr::HdPrimTypeTokens->basisCurves, this, pxr::SdfPath("/curves") );
+
+	currentLod = SelectLod();
+	BuildLod(currentLod);
+	_valueCache.Set(pxr::SdfPath("/curves"), pxr::HdTokens->widths, pxr::VtValue(lods[currentLod].widths));
+	UpdatePoints();
 }
 
 void
 SceneDelegate::AddRenderTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->collection]
-			= pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->collection,
+			pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull));
 }
 
 void
 SceneDelegate::AddRenderSetupTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderSetupTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
 	pxr::HdxRenderTaskParams params;
 	params.camera = cameraPath;
 	params.viewport = pxr::GfVec4f(0, 0, 512, 512);
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->params] = pxr::VtValue(params);
+	viewportHeight = params.viewport[3];
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->params, pxr::VtValue(params));
 }
 
 void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
@@ -52,10 +82,14 @@ void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d
 
 void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
 {
-	_ValueCache &cache = _valueCacheMap[cameraId];
-	cache[pxr::HdCameraTokens->windowPolicy] = pxr::VtValue(pxr::CameraUtilFit);
-	cache[pxr::HdCameraTokens->worldToViewMatrix] = pxr::VtValue(viewMatrix);
-	cache[pxr::HdCameraTokens->projectionMatrix] = pxr::VtValue(projMatrix);
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->windowPolicy, pxr::VtValue(pxr::CameraUtilFit));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->worldToViewMatrix, pxr::VtValue(viewMatrix));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->projectionMatrix, pxr::VtValue(projMatrix));
+	if (cameraId == cameraPath)
+	{
+		this->viewMatrix = viewMatrix;
+		this->projMatrix = projMatrix;
+	}
 
 	GetRenderIndex().GetChangeTracker().MarkSprimDirty(cameraId, pxr::HdCamera::AllDirty);
 }
@@ -63,10 +97,9 @@ void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d cons
 
 pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 {
-	std::cout << "[" << id.GetString() <<"][" << key << "]" << std::endl;
-	_ValueCache *vcache = pxr::TfMapLookupPtr(_valueCacheMap, id);
+	DELEGATE_LOG << "[" << id.GetString() <<"][" << key << "]" << std::endl;
 	pxr::VtValue ret;
-	if (vcache && pxr::TfMapLookup(*vcache, key, &ret)) {
+	if (_valueCache.Find(id, key, &ret)) {
 		return ret;
 	}
 
@@ -75,48 +108,25 @@ pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 		return pxr::VtValue();
 	}
 
-	const int arraySize = 20;
-	const float size = 2.0;
-
-	const float cellSize = size / arraySize;
-
-	if (key == pxr::HdTokens->points)
-	{
-		pxr::VtVec3fArray points;
-
-		for (size_t i = 0; i < arraySize; ++i)
-		{
-			for (size_t j = 0; j < arraySize; ++j)
-			{
-				for (size_t k = 0; k < 4; ++k)
-				{
-					points.push_back(pxr::GfVec3f(i * cellSize + sin(rotation * 0.01f + 0.1f * (i+j+k)) * 0.01f * k, k * 0.25 , j * cellSize + cos(rotation * 0.01 + 0.1f *(i+j+k)) * 0.1f * k) - pxr::GfVec3f(0.5f * size, 0.5f *size, 0.5f *size));
-				}
-			}
-		}
-
-
-		return pxr::VtValue(points);
-	}
-
+	// points are in _valueCache
 	return pxr::VtValue();
 }
 
 bool SceneDelegate::GetVisible(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Visible]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Visible]" << std::endl;
 	return true;
 }
 
 pxr::GfRange3d SceneDelegate::GetExtent(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Extent]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Extent]" << std::endl;
 	return pxr::GfRange3d(pxr::GfVec3d(-1,-1,-1), pxr::GfVec3d(1,1,1));
 }
 
 pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Transform]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Transform]" << std::endl;
 	if (id == pxr::SdfPath("/curves") )
 	{
 		pxr::GfMatrix4d m ;
@@ -127,49 +137,133 @@ pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 
 pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath const& id, pxr::HdInterpolation interpolation)
 {
-	std::cout << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
 	pxr::HdPrimvarDescriptorVector primvarDescriptors;
 
 	if (interpolation == pxr::HdInterpolation::HdInterpolationVertex)
 	{
 		primvarDescriptors.push_back(pxr::HdPrimvarDescriptor(pxr::HdTokens->points, interpolation));
-
+		primvarDescriptors.push_back(pxr::HdPrimvarDescriptor(pxr::HdTokens->widths, interpolation));
 	}
 
 	return primvarDescriptors;
 }
 
 
-void SceneDelegate::UpdateTransform()
+int SceneDelegate::SelectLod() const
 {
-	rotation += 1.0f;
-
-	GetRenderIndex().GetChangeTracker().MarkRprimDirty(pxr::SdfPath("/curves"), pxr::HdChangeTracker::DirtyTransform | pxr::HdChangeTracker::DirtyPoints);
-
+	// Spacing in pixels between neighbouring curves, where the grid comes
+	// nearest the camera. The grid turns about the y axis, so its bounding
+	// sphere stands for it whatever the rotation.
+	const pxr::GfVec3d eye = viewMatrix.GetInverse().Transform(pxr::GfVec3d(0, 0, 0));
+	const pxr::GfVec3d center(0, 0.5 * 0.75 - 0.5 * size, 0);
+	const double radius = std::sqrt(0.5 * size * size + 0.75 * 0.75);
+	const double distance = std::max((eye - center).GetLength() - radius, 0.01);
+	const double pixelsPerUnit = projMatrix[1][1] * 0.5 * viewportHeight / distance;
+	const double spacing = pixelsPerUnit * size / arraySize;
+
+	// Thinning to a fraction f of the curves spreads them 1/sqrt(f) further
+	// apart, keep just enough for minCurveSpacing.
+	const double fraction = std::min(1.0, (spacing * spacing) / (minCurveSpacing * minCurveSpacing));
+	const int level = int(std::ceil(-std::log2(fraction)));
+	return std::min(std::max(level, 0), numLods - 1);
 }
 
-pxr::HdBasisCurvesTopology SceneDelegate::GetBasisCurvesTopology(pxr::SdfPath const& id)
+void SceneDelegate::BuildLod(int level)
 {
-	std::cout << "[" << id.GetString() <<"][BasisCurvesTopology]" << std::endl;
+	Lod &lod = lods[level];
+	if (lod.built)
+	{
+		return;
+	}
 
-	const int arraySize = 20;
+	const int numCurves = arraySize * arraySize;
+	const float threshold = std::ldexp(1.0f, -level);
+	for (int c = 0; c < numCurves; ++c)
+	{
+		if (CurveRank(c) < threshold)
+		{
+			lod.curves.push_back(c);
+		}
+	}
+	// never thin a sparse grid away entirely
+	if (lod.curves.empty())
+	{
+		lod.curves.push_back(0);
+	}
+
+	const bool linear = level >= firstLinearLod;
+	lod.numVerts = linear ? 2 : 4;
+	const int numKept = int(lod.curves.size());
 
+	pxr::VtIntArray curveVertexCounts(numKept, lod.numVerts);
+	pxr::VtIntArray curveIndices(numKept * lod.numVerts);
+	for (size_t i = 0; i < curveIndices.size(); ++i)
+	{
+		curveIndices[i] = int(i);
+	}
+	lod.topology = pxr::HdBasisCurvesTopology(linear ? pxr::HdTokens->linear : pxr::HdTokens->cubic,
+											  pxr::HdTokens->bezier, pxr::HdTokens->nonperiodic,
+											  curveVertexCounts, curveIndices);
+
+	// The curves left are widened so that together they cover the same area
+	// on screen as the full set, tapering from root to tip.
+	const float rootWidth = 0.1f * size / arraySize * numCurves / numKept;
+	lod.widths = pxr::VtFloatArray(numKept * lod.numVerts);
+	for (int i = 0; i < numKept; ++i)
+	{
+		for (int k = 0; k < lod.numVerts; ++k)
+		{
+			const float t = k / float(lod.numVerts - 1);
+			lod.widths[i * lod.numVerts + k] = rootWidth * (1.0f - 0.8f * t);
+		}
+	}
 
-	pxr::VtIntArray curveVertexCounts;
-	pxr::VtIntArray curveIndices;
-	int index = 0;
+	lod.built = true;
+}
 
-	for (size_t i = 0; i < arraySize; ++i)
+void SceneDelegate::UpdatePoints()
+{
+	const float cellSize = size / arraySize;
+	const Lod &lod = lods[currentLod];
+
+	// Only the curves the level draws, and for straight lines only the root
+	// and tip of the cubic's control points.
+	pxr::VtVec3fArray points(lod.curves.size() * lod.numVerts);
+	const int step = lod.numVerts == 2 ? 3 : 1;
+	size_t index = 0;
+	for (int c : lod.curves)
 	{
-		for (size_t j = 0; j < arraySize; ++j)
+		const int i = c / arraySize;
+		const int j = c % arraySize;
+		for (int k = 0; k < 4; k += step)
 		{
-			curveVertexCounts.push_back(4);
-			for (size_t k = 0; k < 4; ++k)
-			{
-				curveIndices.push_back(index++);
-			}
+			points[index++] = pxr::GfVec3f(i * cellSize + sin(rotation * 0.01f + 0.1f * (i+j+k)) * 0.01f * k, k * 0.25 , j * cellSize + cos(rotation * 0.01 + 0.1f *(i+j+k)) * 0.1f * k) - pxr::GfVec3f(0.5f * size, 0.5f *size, 0.5f *size);
 		}
 	}
+	_valueCache.Set(pxr::SdfPath("/curves"), pxr::HdTokens->points, pxr::VtValue(points));
+}
+
+void SceneDelegate::UpdateTransform()
+{
+	rotation += 1.0f;
+
+	pxr::HdDirtyBits dirtyBits = pxr::HdChangeTracker::DirtyTransform | pxr::HdChangeTracker::DirtyPoints;
+	const int level = SelectLod();
+	if (level != currentLod)
+	{
+		BuildLod(level);
+		currentLod = level;
+		_valueCache.Set(pxr::SdfPath("/curves"), pxr::HdTokens->widths, pxr::VtValue(lods[currentLod].widths));
+		dirtyBits |= pxr::HdChangeTracker::DirtyTopology | pxr::HdChangeTracker::DirtyWidths;
+	}
+	UpdatePoints();
 
-	return pxr::HdBasisCurvesTopology(pxr::HdTokens->cubic, pxr::HdTokens->bezier, pxr::HdTokens->nonperiodic, curveVertexCounts, curveIndices );
+	GetRenderIndex().GetChangeTracker().MarkRprimDirty(pxr::SdfPath("/curves"), dirtyBits);
+}
+
+pxr::HdBasisCurvesTopology SceneDelegate::GetBasisCurvesTopology(pxr::SdfPath const& id)
+{
+	DELEGATE_LOG << "[" << id.GetString() <<"][BasisCurvesTopology]" << std::endl;
+	return lods[currentLod].topology;
 }
\ No newline at end of file
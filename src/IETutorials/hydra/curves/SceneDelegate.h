@@ -2,11 +2,17 @@
 
 #include "pxr/imaging/hd/sceneDelegate.h"
 
+#include "ValueCache.h"
+
+#include <vector>
+
 
 class SceneDelegate : public pxr::HdSceneDelegate
 {
 public:
-	SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const& delegateID);
+	// a grid of curvesPerSide x curvesPerSide curves, seen from cameraDistance
+	SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const& delegateID,
+				  int curvesPerSide = 20, float cameraDistance = 3.0f);
 
 	void AddRenderTask(pxr::SdfPath const &id);
 	void AddRenderSetupTask(pxr::SdfPath const &id);
@@ -14,6 +20,10 @@ public:
 	void SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix);
 	void SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix);
 
+	// Make the parameter edits since the last call visible to Hydra, once
+	// per frame before HdEngine::Execute.
+	void PublishEdits() { _valueCache.Publish(); }
+
 	// interface Hydra uses query information from the SceneDelegate when processing an 
 	// Prim in the RenderIndex
 	pxr::VtValue Get(pxr::SdfPath const &id, const pxr::TfToken &key) override;
@@ -26,12 +36,46 @@ public:
 
 	pxr::HdPrimvarDescriptorVector GetPrimvarDescriptors(pxr::SdfPath const& id, pxr::HdInterpolation interpolation) override;
 
+	// animates the points, and picks the level of detail for the camera
 	void UpdateTransform();
 private:
-	// per location (SdfPath) cache of dictionaries (TfToken -> VtValue) 
-	typedef pxr::TfHashMap<pxr::TfToken, pxr::VtValue, pxr::TfToken::HashFunctor> _ValueCache;
-	typedef pxr::TfHashMap<pxr::SdfPath, _ValueCache, pxr::SdfPath::Hash> _ValueCacheMap;
-	_ValueCacheMap _valueCacheMap;
+	// Level of detail L draws the curves whose rank is below 2^-L. The
+	// levels are nested, so a curve doesn't pop in and out as the level
+	// changes, and are built the first time they are drawn.
+	struct Lod
+	{
+		bool built = false;
+		// the curves drawn, indices into the grid
+		std::vector<int> curves;
+		// control points per curve
+		int numVerts = 0;
+		pxr::HdBasisCurvesTopology topology;
+		pxr::VtFloatArray widths;
+	};
+	static constexpr int numLods = 8;
+	// cubic curves are replaced by straight lines from this level on
+	static constexpr int firstLinearLod = 2;
+	// curves closer together on screen than this are thinned out
+	static constexpr float minCurveSpacing = 2.0f;
+
+	int SelectLod() const;
+	void BuildLod(int level);
+	void UpdatePoints();
+
+	// curves per side of the grid, and its size
+	const int arraySize;
+	static constexpr float size = 2.0f;
+
+	Lod lods[numLods];
+	int currentLod;
+
+	// for SelectLod
+	pxr::GfMatrix4d viewMatrix;
+	pxr::GfMatrix4d projMatrix;
+	float viewportHeight;
+
+	// (path, key) -> value, read lock-free by Hydra's Sync
+	ValueCache _valueCache;
 
 	// location of Camera (setup in ctor)
 	pxr::SdfPath cameraPath;
@@ -22,12 +22,14 @@
 
 #include "SceneDelegate.h"
 
+#include <cstdlib>
+
 
 
 class DebugWindow : public pxr::GarchGLDebugWindow
 {
 public:
-	DebugWindow(const char *title, int width, int height) : GarchGLDebugWindow(title, width, height)
+	DebugWindow(const char *title, int width, int height, int curvesPerSide, float cameraDistance) : GarchGLDebugWindow(title, width, height)
 	{
 		// create a RenderDelegate which is required for the RenderIndex
 		renderDelegate.reset( new pxr::HdStRenderDelegate() );
@@ -41,7 +43,7 @@ public:
 		pxr::SdfPath sceneId("/");
 
 		// SceneDelegate can query information from the client SceneGraph to update the renderer
-		sceneDelegate = new SceneDelegate( index, sceneId );
+		sceneDelegate = new SceneDelegate( index, sceneId, curvesPerSide, cameraDistance );
 
 		// Create two tasks (render setup & render) to the RenderIndex
 		sceneDelegate->AddRenderSetupTask(renderSetupId);
@@ -67,6 +69,9 @@ public:
 
 		sceneDelegate->UpdateTransform();
 
+		// parameter edits made since the last frame
+		sceneDelegate->PublishEdits();
+
 		// execute the render tasks
 		engine.Execute( *index, tasks );
 	}
@@ -86,8 +91,21 @@ int main(int argc, char** argv)
 		pxr::TfDebug::Enable(pxr::HD_MDI);
 	}
 
+	// curves [curves per side [camera distance]], e.g. curves 2000 30 draws
+	// a fraction of 4M curves
+	int curvesPerSide = 20;
+	float cameraDistance = 3.0f;
+	if (argc > 1)
+	{
+		curvesPerSide = atoi(argv[1]);
+	}
+	if (argc > 2)
+	{
+		cameraDistance = float(atof(argv[2]));
+	}
+
 	// create a window, GLContext & extensions
-	DebugWindow window("hydra - curves", 1280, 720);
+	DebugWindow window("hydra - curves", 1280, 720, curvesPerSide, cameraDistance);
 	window.Init();
 	bool glewInit = pxr::GlfGlewInit();
 	std::cout << "glew:" << glewInit << std::endl;
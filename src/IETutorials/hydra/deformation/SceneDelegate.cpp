@@ -1,4 +1,5 @@
 #include "SceneDelegate.h"
+#include "DelegateLog.h"
 
 #include "pxr/imaging/hd/camera.h"
 #include "pxr/imaging/hdSt/light.h"
@@ -14,11 +15,53 @@
 #include "pxr/imaging/glf/simpleLight.h"
 
 #include "pxr/base/vt/array.h"
+#include "pxr/base/work/loops.h"
 
+#include <cmath>
 
-SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const &delegateID)
+namespace
+{
+	// The wave, h(x, z) = amplitude * sin(k x - phase) * cos(k z - phase + 0.5)
+	const float amplitude = 0.1f;
+	const float frequency = 6.0f;
+	const float halfSize = 2.0f;
+
+	// sin and cos together, to ~1e-7 over a few hundred radians. The angle
+	// is reduced to [-pi/4, pi/4] around the nearest multiple of pi/2, where
+	// the Taylor series are accurate to float precision.
+	inline void FastSinCos(float a, float *s, float *c)
+	{
+		const float twoOverPi = 0.636619772f;
+		// pi/2 split in two so that j * pi/2 is subtracted without rounding
+		const float halfPiHi = 1.5703125f;
+		const float halfPiLo = 4.83826794897e-4f;
+
+		const float j = std::floor(a * twoOverPi + 0.5f);
+		const float r = (a - j * halfPiHi) - j * halfPiLo;
+		const float r2 = r * r;
+
+		const float sr = r + r * r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f)));
+		const float cr = 1.0f + r2 * (-0.5f + r2 * (1.0f / 24.0f + r2 * (-1.0f / 720.0f + r2 * (1.0f / 40320.0f))));
+
+		switch (int(j) & 3)
+		{
+		case 0: *s =  sr; *c =  cr; break;
+		case 1: *s =  cr; *c = -sr; break;
+		case 2: *s = -sr; *c = -cr; break;
+		default: *s = -cr; *c =  sr; break;
+		}
+	}
+}
+
+
+SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const &delegateID, int numSegments)
  : pxr::HdSceneDelegate(parentIndex, delegateID),
-		rotation(0.0)
+		rotation(0.0),
+		numXSegments(numSegments),
+		numYSegments(numSegments),
+		numXVerts(numSegments + 1),
+		numYVerts(numSegments + 1),
+		nextBuffer(0)
 {
 	cameraPath = pxr::SdfPath("/camera");
 	GetRenderIndex().InsertSprim(pxr::HdPrimTypeTokens->camera, this, cameraPath);
@@ -29,6 +72,31 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
 
 	GetRenderIndex().InsertRprim(pxr::HdPrimTypeTokens->mesh, this, pxr::SdfPath("/plane") );
 
+	// The grid's topology never changes: build it once. Points and normals
+	// are regenerated when the deformation advances.
+	pxr::VtIntArray vertCountsPerFace(numXSegments * numYSegments, 4);
+	pxr::VtIntArray verts(numXSegments * numYSegments * 4);
+
+	auto faceIndex = [this](int x, int y) -> int {
+		return y * numXVerts + x;
+	};
+
+	int *vert = verts.data();
+	for (int x = 0; x  < numXSegments; ++x)
+	{
+		for (int y = 0; y < numYSegments; ++y)
+		{
+			*vert++ = faceIndex(x,y);
+			*vert++ = faceIndex(x+1,y);
+			*vert++ = faceIndex(x+1,y+1);
+			*vert++ = faceIndex(x,y+1);
+		}
+	}
+	planeTopology = pxr::HdMeshTopology(pxr::PxOsdOpenSubdivTokens->none, pxr::HdTokens->rightHanded,
+										vertCountsPerFace, verts);
+
+	UpdatePlane();
+
 	// prep lights
 	pxr::GlfSimpleLight light1;
 
@@ -48,7 +116,6 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
 
 	auto path = pxr::SdfPath("/light1");
 	GetRenderIndex().InsertSprim(pxr::HdPrimTypeTokens->simpleLight, this, path);
-	_ValueCache &cache = _valueCacheMap[path];
 
 	pxr::HdxShadowParams shadowParams;
 	shadowParams.enabled = false;
@@ -56,41 +123,38 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
 	shadowParams.bias = -0.001;
 	shadowParams.blur = 0.1;
 
-	cache[pxr::HdLightTokens->params] = light1;
-	cache[pxr::HdLightTokens->shadowParams] = shadowParams;
-	cache[pxr::HdLightTokens->shadowCollection] = pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->refined);
+	_valueCache.Set(path, pxr::HdLightTokens->params, light1);
+	_valueCache.Set(path, pxr::HdLightTokens->shadowParams, shadowParams);
+	_valueCache.Set(path, pxr::HdLightTokens->shadowCollection, pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->refined));
 }
 
 void SceneDelegate::AddRenderTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->collection] = pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->collection, pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull));
 }
 
 void SceneDelegate::AddRenderSetupTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderSetupTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
 	pxr::HdxRenderTaskParams params;
 	params.enableLighting = true;
 	params.camera = cameraPath;
 	params.viewport = pxr::GfVec4f(0, 0, 512, 512);
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->params] = pxr::VtValue(params);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->params, pxr::VtValue(params));
 }
 
 void SceneDelegate::AddSimpleLightTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxSimpleLightTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
 	pxr::HdxSimpleLightTaskParams params;
 	params.cameraPath = cameraPath;
 	params.viewport = pxr::GfVec4f(0,0,512,512);
 
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->params] = pxr::VtValue(params);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->params, pxr::VtValue(params));
 
 }
 void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
@@ -100,10 +164,9 @@ void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d
 
 void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
 {
-	_ValueCache &cache = _valueCacheMap[cameraId];
-	cache[pxr::HdCameraTokens->windowPolicy] = pxr::VtValue(pxr::CameraUtilFit);
-	cache[pxr::HdCameraTokens->worldToViewMatrix] = pxr::VtValue(viewMatrix);
-	cache[pxr::HdCameraTokens->projectionMatrix] = pxr::VtValue(projMatrix);
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->windowPolicy, pxr::VtValue(pxr::CameraUtilFit));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->worldToViewMatrix, pxr::VtValue(viewMatrix));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->projectionMatrix, pxr::VtValue(projMatrix));
 
 	GetRenderIndex().GetChangeTracker().MarkSprimDirty(cameraId, pxr::HdCamera::AllDirty);
 }
@@ -111,10 +174,9 @@ void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d cons
 
 pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 {
-	//std::cout << "Get-" << "[" << id.GetString() <<"][" << key << "]" << std::endl;
-	_ValueCache *vcache = pxr::TfMapLookupPtr(_valueCacheMap, id);
+	DELEGATE_LOG << "Get-" << "[" << id.GetString() <<"][" << key << "]" << std::endl;
 	pxr::VtValue ret;
-	if (vcache && pxr::TfMapLookup(*vcache, key, &ret)) {
+	if (_valueCache.Find(id, key, &ret)) {
 		return ret;
 	}
 
@@ -124,56 +186,18 @@ pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 	}
 
 
-	if (id == pxr::SdfPath("/plane"))
+	if (id == pxr::SdfPath("/plane") && key == pxr::HdTokens->color)
 	{
-		if (key == pxr::HdTokens->color)
-		{
-			return pxr::VtValue(pxr::GfVec4f(0.2, 0.3, 0.2, 1.0));
-		}
-
-		if (key == pxr::HdTokens->points)
-		{
-			pxr::VtVec3fArray points;
-
-			for (int x = 0; x  < numXVerts ; ++x)
-			{
-				for (int y = 0; y < numYVerts ; ++y)
-				{
-					float fx = 4.0f * (x / (float) numXVerts - 0.5f);
-					float fy = 4.0f * (y / (float) numYVerts - 0.5f);
-					points.push_back(pxr::GfVec3f( fx,  0.1f * sin( 6.0f * fx - rotation )* cos( 6.0f * fy - rotation + 0.5f), fy));
-				}
-			}
-
-			return pxr::VtValue(points);
-		}
-
-
-		if (key == pxr::HdTokens->normals)
-		{
-			pxr::VtVec3fArray normals;
-
-
-			for (int x = 0; x  < numXVerts ; ++x)
-			{
-				for (int y = 0; y < numYVerts ; ++y)
-				{
-					normals.push_back(pxr::GfVec3f(0,1,0));
-				}
-			}
-
-
-			return pxr::VtValue(normals);
-		}
+		return pxr::VtValue(pxr::GfVec4f(0.2, 0.3, 0.2, 1.0));
 	}
 
-
+	// points and normals are in _valueCache
 	return pxr::VtValue();
 }
 
 pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath const& id, pxr::HdInterpolation interpolation)
 {
-	std::cout << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
 	pxr::HdPrimvarDescriptorVector primvarDescriptors;
 
 	if (interpolation == pxr::HdInterpolation::HdInterpolationVertex)
@@ -195,13 +219,13 @@ pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath
 
 bool SceneDelegate::GetVisible(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Visible]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Visible]" << std::endl;
 	return true;
 }
 
 pxr::GfRange3d SceneDelegate::GetExtent(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Extent]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Extent]" << std::endl;
 	return pxr::GfRange3d(pxr::GfVec3d(-1,-1,-1), pxr::GfVec3d(1,1,1));
 }
 
@@ -213,45 +237,88 @@ pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 
 pxr::HdMeshTopology SceneDelegate::GetMeshTopology(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Topology]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Topology]" << std::endl;
 
 	if ( id == pxr::SdfPath("/plane"))
 	{
-		pxr::VtArray<int> vertCountsPerFace;
-		pxr::VtArray<int> verts;
+		return planeTopology;
+	}
+	return pxr::HdMeshTopology();
+}
 
+void SceneDelegate::UpdateCubeTransform()
+{
+	rotation += 0.1f;
+	UpdatePlane();
+
+	GetRenderIndex().GetChangeTracker().MarkRprimDirty(pxr::SdfPath("/plane"),
+		pxr::HdChangeTracker::DirtyPoints | pxr::HdChangeTracker::DirtyNormals);
+}
 
-		auto faceIndex = [this](int x, int y) -> int {
-			int numXVerts = numXSegments + 1;
-			return y * numXVerts + x;
-		};
+void SceneDelegate::UpdatePlane()
+{
+	// The wave is separable: the sin/cos of the x term is shared by a whole
+	// row and that of the z term by a whole column, so only
+	// numXVerts + numYVerts of each are evaluated per frame.
+	rowSin.resize(numXVerts);
+	rowCos.resize(numXVerts);
+	columnSin.resize(numYVerts);
+	columnCos.resize(numYVerts);
+	for (int x = 0; x < numXVerts; ++x)
+	{
+		const float fx = 2.0f * halfSize * (x / (float) numXVerts - 0.5f);
+		FastSinCos(frequency * fx - rotation, &rowSin[x], &rowCos[x]);
+	}
+	for (int y = 0; y < numYVerts; ++y)
+	{
+		const float fy = 2.0f * halfSize * (y / (float) numYVerts - 0.5f);
+		FastSinCos(frequency * fy - rotation + 0.5f, &columnSin[y], &columnCos[y]);
+	}
 
-		for (int x = 0; x  < numXSegments; ++x)
+	// Write into the oldest of the buffers. By now the value cache and Hydra
+	// have let go of it, so VtArray doesn't copy on write; if something still
+	// holds it the write detaches a copy, which is slower but still correct.
+	pxr::VtVec3fArray &points = pointBuffers[nextBuffer];
+	pxr::VtVec3fArray &normals = normalBuffers[nextBuffer];
+	nextBuffer = (nextBuffer + 1) % numBuffers;
+	points.resize(numXVerts * numYVerts);
+	normals.resize(numXVerts * numYVerts);
+
+	float *pointData = reinterpret_cast<float *>(points.data());
+	float *normalData = reinterpret_cast<float *>(normals.data());
+	const float *sz = columnSin.data();
+	const float *cz = columnCos.data();
+	const int numY = numYVerts;
+	const float zStep = 2.0f * halfSize / numYVerts;
+
+	// rows are independent; the inner loop is straight-line float code over
+	// the column tables, which the compiler vectorizes
+	pxr::WorkParallelForN(numXVerts, [&](size_t begin, size_t end) {
+		for (size_t x = begin; x < end; ++x)
 		{
-			for (int y = 0; y < numYSegments; ++y)
+			const float fx = 2.0f * halfSize * (x / (float) numXVerts - 0.5f);
+			const float sx = rowSin[x];
+			const float cx = rowCos[x];
+			float *p = pointData + 3 * x * numY;
+			float *n = normalData + 3 * x * numY;
+			for (int y = 0; y < numY; ++y)
 			{
-				vertCountsPerFace.push_back(4);
-
-				verts.push_back(faceIndex(x,y));
-				verts.push_back(faceIndex(x+1,y));
-				verts.push_back(faceIndex(x+1,y+1));
-				verts.push_back(faceIndex(x,y+1));
+				const float fy = -halfSize + y * zStep;
+				p[3 * y + 0] = fx;
+				p[3 * y + 1] = amplitude * sx * cz[y];
+				p[3 * y + 2] = fy;
+
+				// normal of y = h(x, z) is (-dh/dx, 1, -dh/dz), normalized
+				const float dhdx = amplitude * frequency * cx * cz[y];
+				const float dhdz = -amplitude * frequency * sx * sz[y];
+				const float scale = 1.0f / std::sqrt(1.0f + dhdx * dhdx + dhdz * dhdz);
+				n[3 * y + 0] = -dhdx * scale;
+				n[3 * y + 1] = scale;
+				n[3 * y + 2] = -dhdz * scale;
 			}
 		}
+	});
 
-
-		pxr::HdMeshTopology triangleTopology(pxr::PxOsdOpenSubdivTokens->none, pxr::HdTokens->rightHanded,
-											 vertCountsPerFace, verts);
-		return triangleTopology;
-	}
-
+	_valueCache.Set(pxr::SdfPath("/plane"), pxr::HdTokens->points, pxr::VtValue(points));
+	_valueCache.Set(pxr::SdfPath("/plane"), pxr::HdTokens->normals, pxr::VtValue(normals));
 }
-
-void SceneDelegate::UpdateCubeTransform()
-{
-	rotation += 0.1f;
-
-	// |pxr::HdChangeTracker::DirtyNormals
-	GetRenderIndex().GetChangeTracker().MarkRprimDirty(pxr::SdfPath("/plane"),  pxr::HdChangeTracker::DirtyPoints);
-
-}
\ No newline at end of file
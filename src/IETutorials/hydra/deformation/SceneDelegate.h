@@ -2,11 +2,16 @@
 
 #include "pxr/imaging/hd/sceneDelegate.h"
 
+#include "ValueCache.h"
+
+#include <vector>
+
 
 class SceneDelegate : public pxr::HdSceneDelegate
 {
 public:
-	SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const& delegateID);
+	// the plane is a grid of numSegments x numSegments quads
+	SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const& delegateID, int numSegments = 256);
 
 	void AddRenderTask(pxr::SdfPath const &id);
 	void AddRenderSetupTask(pxr::SdfPath const &id);
@@ -15,6 +20,10 @@ public:
 	void SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix);
 	void SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix);
 
+	// Make the parameter edits since the last call visible to Hydra, once
+	// per frame before HdEngine::Execute.
+	void PublishEdits() { _valueCache.Publish(); }
+
 	// interface Hydra uses query information from the SceneDelegate when processing an 
 	// Prim in the RenderIndex
 	pxr::VtValue Get(pxr::SdfPath const &id, const pxr::TfToken &key) override;
@@ -29,19 +38,31 @@ public:
 	void UpdateCubeTransform();
 
 private:
-	// per location (SdfPath) cache of dictionaries (TfToken -> VtValue) 
-	typedef pxr::TfHashMap<pxr::TfToken, pxr::VtValue, pxr::TfToken::HashFunctor> _ValueCache;
-	typedef pxr::TfHashMap<pxr::SdfPath, _ValueCache, pxr::SdfPath::Hash> _ValueCacheMap;
-	_ValueCacheMap _valueCacheMap;
+	void UpdatePlane();
+
+	// (path, key) -> value, read lock-free by Hydra's Sync
+	ValueCache _valueCache;
 
 	// location of Camera (setup in ctor)
 	pxr::SdfPath cameraPath;
 
 	float rotation;
-	static constexpr int numXSegments = 256;
-	static constexpr int numYSegments = 256;
+	const int numXSegments;
+	const int numYSegments;
+
+	const int numXVerts;
+	const int numYVerts;
+
+	pxr::HdMeshTopology planeTopology;
+
+	// sin/cos of the wave's x term per row and of its z term per column
+	std::vector<float> rowSin, rowCos;
+	std::vector<float> columnSin, columnCos;
 
-	static constexpr int numXVerts = numXSegments + 1;
-	static constexpr int numYVerts = numYSegments + 1;
+	// points and normals are written into these in turn, see UpdatePlane
+	static constexpr int numBuffers = 3;
+	pxr::VtVec3fArray pointBuffers[numBuffers];
+	pxr::VtVec3fArray normalBuffers[numBuffers];
+	int nextBuffer;
 
 };
\ No newline at end of file
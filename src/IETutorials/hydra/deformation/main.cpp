@@ -22,12 +22,15 @@
 
 #include "SceneDelegate.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 
 
 class DebugWindow : public pxr::GarchGLDebugWindow
 {
 public:
-	DebugWindow(const char *title, int width, int height) : GarchGLDebugWindow(title, width, height)
+	DebugWindow(const char *title, int width, int height, int numSegments) : GarchGLDebugWindow(title, width, height)
 	{
 		// create a RenderDelegate which is required for the RenderIndex
 		renderDelegate.reset( new pxr::HdStRenderDelegate() );
@@ -42,7 +45,7 @@ public:
 		pxr::SdfPath sceneId("/");
 
 		// SceneDelegate can query information from the client SceneGraph to update the renderer
-		sceneDelegate = new SceneDelegate( index, sceneId );
+		sceneDelegate = new SceneDelegate( index, sceneId, numSegments );
 
 		// Create two tasks (render setup & render) to the RenderIndex
 		sceneDelegate->AddRenderSetupTask(renderSetupId);
@@ -70,6 +73,9 @@ public:
 		glDepthFunc(GL_LESS);
 		glEnable(GL_DEPTH_TEST);
 
+		// parameter edits made since the last frame
+		sceneDelegate->PublishEdits();
+
 		// execute the render tasks
 		engine.Execute( *index, tasks );
 	}
@@ -89,8 +95,15 @@ int main(int argc, char** argv)
 		pxr::TfDebug::Enable(pxr::HD_MDI);
 	}
 
+	// deformation [segments], 2047 segments deform a plane of 4M vertices
+	int numSegments = 256;
+	if (argc > 1)
+	{
+		numSegments = std::max(1, atoi(argv[1]));
+	}
+
 	// create a window, GLContext & extensions
-	DebugWindow window("hydra - deformation", 1280, 720);
+	DebugWindow window("hydra - deformation", 1280, 720, numSegments);
 	window.Init();
 	bool glewInit = pxr::GlfGlewInit();
 	std::cout << "glew:" << glewInit << std::endl;
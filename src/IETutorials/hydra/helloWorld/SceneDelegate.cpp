@@ -1,4 +1,5 @@
 #include "SceneDelegate.h"
+#include "DelegateLog.h"
 
 #include "pxr/imaging/hd/camera.h"
 #include "pxr/imaging/cameraUtil/conformWindow.h"
@@ -21,23 +22,28 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
     SetCamera(frustum.ComputeViewMatrix(), frustum.ComputeProjectionMatrix());
 
     GetRenderIndex().InsertRprim(pxr::HdPrimTypeTokens->mesh, this, pxr::SdfPath("/triangle"));
+
+    // the triangle never changes, so Get() serves one shared copy
+    pxr::VtVec3fArray points(3);
+    points[0] = pxr::GfVec3f(0, 0, 0);
+    points[1] = pxr::GfVec3f(1, 0, 0);
+    points[2] = pxr::GfVec3f(0, 1, 0);
+    _valueCache.Set(pxr::SdfPath("/triangle"), pxr::HdTokens->points, pxr::VtValue(points));
 }
 
 void SceneDelegate::AddRenderTask(pxr::SdfPath const &id)
 {
     GetRenderIndex().InsertTask<pxr::HdxRenderTask>(this, id);
-    _ValueCache &cache = _valueCacheMap[id];
-    cache[pxr::HdTokens->collection] = pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdReprSelector(pxr::HdReprTokens->smoothHull));
+    _valueCache.Set(id, pxr::HdTokens->collection, pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdReprSelector(pxr::HdReprTokens->smoothHull)));
 }
 
 void SceneDelegate::AddRenderSetupTask(pxr::SdfPath const &id)
 {
     GetRenderIndex().InsertTask<pxr::HdxRenderSetupTask>(this, id);
-    _ValueCache &cache = _valueCacheMap[id];
     pxr::HdxRenderTaskParams params;
     params.camera = cameraPath;
     params.viewport = pxr::GfVec4f(0, 0, 512, 512);
-    cache[pxr::HdTokens->params] = pxr::VtValue(params);
+    _valueCache.Set(id, pxr::HdTokens->params, pxr::VtValue(params));
 }
 
 void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
@@ -47,57 +53,46 @@ void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d
 
 void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
 {
-    _ValueCache &cache = _valueCacheMap[cameraId];
-    cache[pxr::HdCameraTokens->windowPolicy] = pxr::VtValue(pxr::CameraUtilFit);
-    cache[pxr::HdCameraTokens->worldToViewMatrix] = pxr::VtValue(viewMatrix);
-    cache[pxr::HdCameraTokens->projectionMatrix] = pxr::VtValue(projMatrix);
+    _valueCache.Set(cameraId, pxr::HdCameraTokens->windowPolicy, pxr::VtValue(pxr::CameraUtilFit));
+    _valueCache.Set(cameraId, pxr::HdCameraTokens->worldToViewMatrix, pxr::VtValue(viewMatrix));
+    _valueCache.Set(cameraId, pxr::HdCameraTokens->projectionMatrix, pxr::VtValue(projMatrix));
 
     GetRenderIndex().GetChangeTracker().MarkSprimDirty(cameraId, pxr::HdCamera::AllDirty);
 }
 
 pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 {
-    std::cout << "[" << id.GetString() << "][" << key << "]" << std::endl;
-    _ValueCache *vcache = pxr::TfMapLookupPtr(_valueCacheMap, id);
+    DELEGATE_LOG << "[" << id.GetString() << "][" << key << "]" << std::endl;
     pxr::VtValue ret;
-    if (vcache && pxr::TfMapLookup(*vcache, key, &ret))
+    if (_valueCache.Find(id, key, &ret))
     {
         return ret;
     }
 
-    if (key == pxr::HdTokens->points)
-    {
-        pxr::VtVec3fArray points;
-        points.push_back(pxr::GfVec3f(0, 0, 0));
-        points.push_back(pxr::GfVec3f(1, 0, 0));
-        points.push_back(pxr::GfVec3f(0, 1, 0));
-        return pxr::VtValue(points);
-    }
-
     return pxr::VtValue();
 }
 
 bool SceneDelegate::GetVisible(pxr::SdfPath const &id)
 {
-    std::cout << "[" << id.GetString() << "][Visible]" << std::endl;
+    DELEGATE_LOG << "[" << id.GetString() << "][Visible]" << std::endl;
     return true;
 }
 
 pxr::GfRange3d SceneDelegate::GetExtent(pxr::SdfPath const &id)
 {
-    std::cout << "[" << id.GetString() << "][Extent]" << std::endl;
+    DELEGATE_LOG << "[" << id.GetString() << "][Extent]" << std::endl;
     return pxr::GfRange3d(pxr::GfVec3d(-1, -1, -1), pxr::GfVec3d(1, 1, 1));
 }
 
 pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 {
-    std::cout << "[" << id.GetString() << "][Transform]" << std::endl;
+    DELEGATE_LOG << "[" << id.GetString() << "][Transform]" << std::endl;
     return pxr::GfMatrix4d(1.0f);
 }
 
 pxr::HdMeshTopology SceneDelegate::GetMeshTopology(pxr::SdfPath const &id)
 {
-    std::cout << "[" << id.GetString() << "][Topology]" << std::endl;
+    DELEGATE_LOG << "[" << id.GetString() << "][Topology]" << std::endl;
     pxr::VtArray<int> vertCountsPerFace;
     pxr::VtArray<int> verts;
     vertCountsPerFace.push_back(3);
@@ -110,7 +105,7 @@ pxr::HdMeshTopology SceneDelegate::GetMeshTopology(pxr::SdfPath const &id)
 
 pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath const &id, pxr::HdInterpolation interpolation)
 {
-    std::cout << "[" << id.GetString() << "][GetPrimvarDescriptors]" << std::endl;
+    DELEGATE_LOG << "[" << id.GetString() << "][GetPrimvarDescriptors]" << std::endl;
     pxr::HdPrimvarDescriptorVector primvarDescriptors;
     if (interpolation == pxr::HdInterpolation::HdInterpolationVertex)
     {
@@ -122,9 +117,8 @@ pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath
 /*virtual*/
 pxr::VtValue SceneDelegate::GetCameraParamValue(pxr::SdfPath const &cameraId, pxr::TfToken const &paramName)
 {
-    auto vcache = pxr::TfMapLookupPtr(_valueCacheMap, cameraId);
     pxr::VtValue ret;
-    if (vcache && TfMapLookup(*vcache, paramName, &ret))
+    if (_valueCache.Find(cameraId, paramName, &ret))
     {
         return ret;
     }
@@ -2,6 +2,8 @@
 
 #include "pxr/imaging/hd/sceneDelegate.h"
 
+#include "ValueCache.h"
+
 
 class SceneDelegate : public pxr::HdSceneDelegate
 {
@@ -14,6 +16,10 @@ public:
 	void SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix);
 	void SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix);
 
+	// Make the parameter edits since the last call visible to Hydra, once
+	// per frame before HdEngine::Execute.
+	void PublishEdits() { _valueCache.Publish(); }
+
 	// interface Hydra uses query information from the SceneDelegate when processing an 
 	// Prim in the RenderIndex
 	pxr::VtValue Get(pxr::SdfPath const &id, const pxr::TfToken &key) override;
@@ -27,10 +33,8 @@ public:
 	pxr::HdPrimvarDescriptorVector GetPrimvarDescriptors(pxr::SdfPath const& id, pxr::HdInterpolation interpolation) override;
     pxr::VtValue GetCameraParamValue(pxr::SdfPath const &cameraId, pxr::TfToken const &paramName);
 private:
-	// per location (SdfPath) cache of dictionaries (TfToken -> VtValue) 
-	typedef pxr::TfHashMap<pxr::TfToken, pxr::VtValue, pxr::TfToken::HashFunctor> _ValueCache;
-	typedef pxr::TfHashMap<pxr::SdfPath, _ValueCache, pxr::SdfPath::Hash> _ValueCacheMap;
-	_ValueCacheMap _valueCacheMap;
+	// (path, key) -> value, read lock-free by Hydra's Sync
+	ValueCache _valueCache;
 
 	// location of Camera (setup in ctor)
 	pxr::SdfPath cameraPath;
@@ -92,6 +92,9 @@ public:
         pxr::SdfPath renderTask("/renderTask");
         tasks.push_back(_sceneDelegate->GetRenderIndex().GetTask(renderSetupTask));
         tasks.push_back(_sceneDelegate->GetRenderIndex().GetTask(renderTask));
+        // parameter edits made since the last frame
+        _sceneDelegate->PublishEdits();
+
         _engine.Execute(_renderIndex, &tasks);
 
         glBindVertexArray(0);
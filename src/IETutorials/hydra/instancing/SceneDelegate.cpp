@@ -1,4 +1,5 @@
 #include "SceneDelegate.h"
+#include "DelegateLog.h"
 
 #include "pxr/imaging/hd/camera.h"
 #include "pxr/imaging/cameraUtil/conformWindow.h"
@@ -9,11 +10,45 @@
 #include "pxr/base/gf/range3f.h"
 #include "pxr/base/gf/frustum.h"
 #include "pxr/base/vt/array.h"
+#include "pxr/base/work/loops.h"
 
+#include <algorithm>
+#include <cmath>
 
-SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const &delegateID)
+namespace
+{
+	// the instance field always covers the same square, whatever the count
+	const float fieldSize = 16.0f;
+	// each updated instance turns this much further, in radians
+	const float angleStep = 0.05f;
+
+	// starting angle of instance i, spread by the golden ratio
+	inline float BaseAngle(int i)
+	{
+		const float golden = 0.618033988f;
+		float f = i * golden;
+		return 6.283185307f * (f - std::floor(f));
+	}
+
+	// rotation about a fixed tilted axis, as the (real, i, j, k) quaternion
+	// the instancer's rotate primvar expects
+	inline pxr::GfVec4f AxisAngle(float angle)
+	{
+		const float s = std::sin(0.5f * angle) * 0.707106781f;
+		return pxr::GfVec4f(std::cos(0.5f * angle), s, s, 0.0f);
+	}
+}
+
+
+SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const &delegateID,
+							 int numInstances, int numUpdatesPerFrame)
  : pxr::HdSceneDelegate(parentIndex, delegateID),
-  rotation(45.0f)
+  rotation(45.0f),
+  instancerPath("/instances"),
+  instanceCount(std::min(std::max(numInstances, 1), maxInstances)),
+  updatesPerFrame(std::min(std::max(numUpdatesPerFrame, 0), instanceCount)),
+  frame(0),
+  nextBuffer(0)
 {
 	cameraPath = pxr::SdfPath("/camera");
 	GetRenderIndex().InsertSprim(pxr::HdPrimTypeTokens->camera, this, cameraPath);
@@ -23,33 +58,106 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
 
 	SetCamera(frustum.ComputeViewMatrix(), frustum.ComputeProjectionMatrix());
 
-	pxr::SdfPath instancerPath("/instances");
 	GetRenderIndex().InsertRprim(pxr::HdPrimTypeTokens->mesh, this, pxr::SdfPath("/cube"), instancerPath); //,
 	GetRenderIndex().InsertInstancer(this, instancerPath);
+
+	// The cube never changes: build its arrays once, Get() hands out shared
+	// copies.
+	const pxr::GfVec3f cubePoints[] = {
+		pxr::GfVec3f(0,0,0), pxr::GfVec3f(1,0,0), pxr::GfVec3f(1,1,0), pxr::GfVec3f(0,1,0),
+		pxr::GfVec3f(0,0,1), pxr::GfVec3f(1,0,1), pxr::GfVec3f(1,1,1), pxr::GfVec3f(0,1,1),
+	};
+	pxr::VtVec3fArray points(8);
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		points[i] = cubePoints[i] - pxr::GfVec3f(0.5f, 0.5f, 0.5f);
+	}
+	_valueCache.Set(pxr::SdfPath("/cube"), pxr::HdTokens->points, pxr::VtValue(points));
+
+	// face-varying, one per face corner
+	const pxr::GfVec3f faceNormals[] = {
+		pxr::GfVec3f(0,0,-1), pxr::GfVec3f(0,0,1), pxr::GfVec3f(1,0,0),
+		pxr::GfVec3f(0,1,0), pxr::GfVec3f(-1,0,0), pxr::GfVec3f(0,-1,0),
+	};
+	pxr::VtVec3fArray normals(24);
+	for (size_t i = 0; i < normals.size(); ++i)
+	{
+		normals[i] = faceNormals[i / 4];
+	}
+	_valueCache.Set(pxr::SdfPath("/cube"), pxr::HdTokens->normals, pxr::VtValue(normals));
+
+	// Instances are laid out on a square grid in the XY plane. Position,
+	// orientation and scale are separate float arrays, authored as the
+	// instancer's translation/rotation/scale primvars: 40 bytes per instance
+	// against 128 for a matrix of doubles.
+	const int instancesPerSide = (int) std::ceil(std::sqrt((double) instanceCount));
+	const float spacing = fieldSize / instancesPerSide;
+	instanceIndices = pxr::VtIntArray(instanceCount);
+	pxr::VtVec3fArray translate(instanceCount);
+	pxr::VtVec4fArray rotate(instanceCount);
+	int *indexData = instanceIndices.data();
+	pxr::GfVec3f *translateData = translate.data();
+	pxr::GfVec4f *rotateData = rotate.data();
+	pxr::WorkParallelForN(instanceCount, [&](size_t begin, size_t end) {
+		for (size_t index = begin; index < end; ++index)
+		{
+			const int i = int(index) / instancesPerSide;
+			const int j = int(index) % instancesPerSide;
+			indexData[index] = int(index);
+			translateData[index] = pxr::GfVec3f(spacing * (i + 0.5f) - 0.5f * fieldSize,
+												spacing * (j + 0.5f) - 0.5f * fieldSize, 0.0f);
+			rotateData[index] = AxisAngle(BaseAngle(int(index)));
+		}
+	});
+	// the cubes keep the proportions of the original 10 x 10 field
+	pxr::VtVec3fArray scale(instanceCount, pxr::GfVec3f(0.625f * spacing));
+
+	_valueCache.Set(instancerPath, pxr::HdTokens->instanceIndices, pxr::VtValue(instanceIndices));
+	_valueCache.Set(instancerPath, pxr::HdInstancerTokens->translate, pxr::VtValue(translate));
+	_valueCache.Set(instancerPath, pxr::HdInstancerTokens->rotate, pxr::VtValue(rotate));
+	_valueCache.Set(instancerPath, pxr::HdInstancerTokens->scale, pxr::VtValue(scale));
+
+	// UpdateTransform writes the rotations into these in turn
+	for (int b = 0; b < numBuffers; ++b)
+	{
+		rotateBuffers[b] = rotate;
+		bufferFrames[b] = 0;
+	}
+
+	const int faceVertexIndices[] = {
+		0, 3, 2, 1,
+		4, 5, 6, 7,
+		1, 2, 6, 5,
+		2, 3, 7, 6,
+		3, 0, 4, 7,
+		0, 1, 5, 4,
+	};
+	pxr::VtIntArray vertCountsPerFace(6, 4);
+	pxr::VtIntArray verts(faceVertexIndices, faceVertexIndices + 24);
+	cubeTopology = pxr::HdMeshTopology(pxr::PxOsdOpenSubdivTokens->none, pxr::HdTokens->rightHanded,
+									   vertCountsPerFace, verts);
 }
 
 void
 SceneDelegate::AddRenderTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->collection]
-			= pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->collection,
+			pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull));
 }
 
 void
 SceneDelegate::AddRenderSetupTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderSetupTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
 	pxr::HdxRenderTaskParams params;
 	params.camera = cameraPath;
 	params.enableLighting = true;
 	params.enableHardwareShading = true;
 	params.viewport = pxr::GfVec4f(0, 0, 512, 512);
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->params] = pxr::VtValue(params);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->params, pxr::VtValue(params));
 }
 
 void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
@@ -59,10 +167,9 @@ void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d
 
 void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
 {
-	_ValueCache &cache = _valueCacheMap[cameraId];
-	cache[pxr::HdCameraTokens->windowPolicy] = pxr::VtValue(pxr::CameraUtilFit);
-	cache[pxr::HdCameraTokens->worldToViewMatrix] = pxr::VtValue(viewMatrix);
-	cache[pxr::HdCameraTokens->projectionMatrix] = pxr::VtValue(projMatrix);
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->windowPolicy, pxr::VtValue(pxr::CameraUtilFit));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->worldToViewMatrix, pxr::VtValue(viewMatrix));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->projectionMatrix, pxr::VtValue(projMatrix));
 
 	GetRenderIndex().GetChangeTracker().MarkSprimDirty(cameraId, pxr::HdCamera::AllDirty);
 }
@@ -70,10 +177,9 @@ void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d cons
 
 pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 {
-	std::cout <<  "[" << id.GetString() <<"][Get][" << key << "]" << std::endl;
-	_ValueCache *vcache = pxr::TfMapLookupPtr(_valueCacheMap, id);
+	DELEGATE_LOG <<  "[" << id.GetString() <<"][Get][" << key << "]" << std::endl;
 	pxr::VtValue ret;
-	if (vcache && pxr::TfMapLookup(*vcache, key, &ret)) {
+	if (_valueCache.Find(id, key, &ret)) {
 		return ret;
 	}
 
@@ -82,123 +188,30 @@ pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 		return pxr::VtValue();
 	}
 
-	if (id == pxr::SdfPath("/cube"))
-	{
-		if (key == pxr::HdTokens->color)
-		{
-			return pxr::VtValue(pxr::GfVec4f(0.3, 0.2, 0.2, 1.0));
-		}
-		else if (key == pxr::HdTokens->points)
-		{
-			pxr::VtVec3fArray points;
-
-			points.push_back(pxr::GfVec3f(0,0,0));
-			points.push_back(pxr::GfVec3f(1,0,0));
-			points.push_back(pxr::GfVec3f(1,1,0));
-			points.push_back(pxr::GfVec3f(0,1,0));
-
-			points.push_back(pxr::GfVec3f(0,0,1));
-			points.push_back(pxr::GfVec3f(1,0,1));
-			points.push_back(pxr::GfVec3f(1,1,1));
-			points.push_back(pxr::GfVec3f(0,1,1));
-
-			for (size_t i = 0; i < points.size(); ++i)
-			{
-				points[i] -= pxr::GfVec3f(0.5f, 0.5f, 0.5f);
-			}
-			return pxr::VtValue(points);
-		}
-		else if (key == pxr::HdTokens->normals)
-		{
-			pxr::VtVec3fArray normals;
-
-			normals.push_back(pxr::GfVec3f(0,0,-1));
-			normals.push_back(pxr::GfVec3f(0,0,-1));
-			normals.push_back(pxr::GfVec3f(0,0,-1));
-			normals.push_back(pxr::GfVec3f(0,0,-1));
-
-			normals.push_back(pxr::GfVec3f(0,0,1));
-			normals.push_back(pxr::GfVec3f(0,0,1));
-			normals.push_back(pxr::GfVec3f(0,0,1));
-			normals.push_back(pxr::GfVec3f(0,0,1));
-
-			normals.push_back(pxr::GfVec3f(1,0,0));
-			normals.push_back(pxr::GfVec3f(1,0,0));
-			normals.push_back(pxr::GfVec3f(1,0,0));
-			normals.push_back(pxr::GfVec3f(1,0,0));
-
-			normals.push_back(pxr::GfVec3f(0,1,0));
-			normals.push_back(pxr::GfVec3f(0,1,0));
-			normals.push_back(pxr::GfVec3f(0,1,0));
-			normals.push_back(pxr::GfVec3f(0,1,0));
-
-			normals.push_back(pxr::GfVec3f(-1,0,0));
-			normals.push_back(pxr::GfVec3f(-1,0,0));
-			normals.push_back(pxr::GfVec3f(-1,0,0));
-			normals.push_back(pxr::GfVec3f(-1,0,0));
-
-			normals.push_back(pxr::GfVec3f(0,-1,0));
-			normals.push_back(pxr::GfVec3f(0,-1,0));
-			normals.push_back(pxr::GfVec3f(0,-1,0));
-			normals.push_back(pxr::GfVec3f(0,-1,0));
-
-
-			return pxr::VtValue(normals);
-		}
-	}
-	else if (id == pxr::SdfPath("/instances"))
+	if (id == pxr::SdfPath("/cube") && key == pxr::HdTokens->color)
 	{
-
-		if (key == pxr::HdTokens->instanceIndices)
-		{
-			pxr::VtIntArray indices;
-
-			int index = 0;
-			for (int i = 0; i < 10; ++i)
-			{
-				for (int j = 0; j < 10; ++j)
-				{
-					indices.push_back(index++);
-				}
-			}
-
-			return pxr::VtValue(indices);
-		}
-		else if (key == pxr::HdTokens->instanceTransform )
-		{
-			pxr::VtMatrix4dArray transforms;
-
-			for (int i = 0; i < 10; ++i)
-			{
-				for (int j = 0; j < 10; ++j)
-				{
-					transforms.push_back(
-							pxr::GfMatrix4d(pxr::GfRotation(pxr::GfVec3d(1, 0, 0), 0.0), pxr::GfVec3d(16.0 * (i / 10.0 - 0.5), 16.0 * (j / 10.0 - 0.5), 0)));
-				}
-			}
-
-			return pxr::VtValue(transforms);
-		}
+		return pxr::VtValue(pxr::GfVec4f(0.3, 0.2, 0.2, 1.0));
 	}
 
+	// the cube's points and normals, and the instance data, are in _valueCache
 	return pxr::VtValue();
 }
 
 bool SceneDelegate::GetVisible(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Visible]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Visible]" << std::endl;
 	return true;
 }
 
 pxr::GfRange3d SceneDelegate::GetExtent(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Extent]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Extent]" << std::endl;
 	return pxr::GfRange3d(pxr::GfVec3d(-1,-1,-1), pxr::GfVec3d(1,1,1));
 }
 
 pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Transform]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Transform]" << std::endl;
 	if (id == pxr::SdfPath("/cube") )
 	{
 		pxr::GfMatrix4d m ;
@@ -211,7 +224,7 @@ pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 
 pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath const& id, pxr::HdInterpolation interpolation)
 {
-	std::cout << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
 	pxr::HdPrimvarDescriptorVector primvarDescriptors;
 
 	if (id == pxr::SdfPath("/cube"))
@@ -228,52 +241,62 @@ pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath
 		{
 			primvarDescriptors.push_back(pxr::HdPrimvarDescriptor(pxr::HdTokens->color, interpolation));
 		}
-//		else if (interpolation == pxr::HdInterpolationInstance)
-//		{
-//			primvarDescriptors.push_back(pxr::HdPrimvarDescriptor(pxr::HdTokens->instanceIndices, interpolation));
-//			primvarDescriptors.push_back(pxr::HdPrimvarDescriptor(pxr::HdTokens->instanceTransform, interpolation));
-//		}
+	}
+	else if (id == instancerPath && interpolation == pxr::HdInterpolationInstance)
+	{
+		primvarDescriptors.push_back(pxr::HdPrimvarDescriptor(pxr::HdInstancerTokens->translate, interpolation));
+		primvarDescriptors.push_back(pxr::HdPrimvarDescriptor(pxr::HdInstancerTokens->rotate, interpolation));
+		primvarDescriptors.push_back(pxr::HdPrimvarDescriptor(pxr::HdInstancerTokens->scale, interpolation));
 	}
 	return primvarDescriptors;
 }
 
-//
-//pxr::TfTokenVector SceneDelegate::GetPrimVarInstanceNames(pxr::SdfPath const &id)
-//{
-//	std::cout << "[" << id.GetString() <<"][GetPrimVarInstanceNames]" << std::endl;
-//
-//	pxr::TfTokenVector names;
-//	names.push_back(pxr::HdTokens->instanceIndices);
-//	names.push_back(pxr::HdTokens->instanceTransform);
-//	return names;
-//}
-
 void SceneDelegate::UpdateTransform()
 {
 	rotation += 1.0f;
-}
 
-pxr::VtIntArray SceneDelegate::GetInstanceIndices(pxr::SdfPath const &instancerId, pxr::SdfPath const &prototypeId)
-{
-	std::cout << "[" << instancerId.GetString() <<"][GetInstanceIndices]:" << prototypeId << std::endl;
-	pxr::VtIntArray indices;
+	if (updatesPerFrame == 0)
+	{
+		return;
+	}
 
-	int index = 0;
-	for (int i = 0; i < 10; ++i)
+	// Turn the next updatesPerFrame instances, a window that walks round the
+	// field. The buffer being written was last brought up to date a few
+	// frames ago: replay the windows it missed, so only those instances are
+	// touched rather than the whole array copied.
+	++frame;
+	pxr::VtVec4fArray &rotate = rotateBuffers[nextBuffer];
+	pxr::GfVec4f *data = rotate.data();
+	for (int f = bufferFrames[nextBuffer] + 1; f <= frame; ++f)
 	{
-		for (int j = 0; j < 10; ++j)
-		{
-			indices.push_back(index++);
-		}
+		const size_t first = (size_t) f * updatesPerFrame;
+		pxr::WorkParallelForN(updatesPerFrame, [&](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; ++k)
+			{
+				const int i = int((first + k) % instanceCount);
+				data[i] = AxisAngle(BaseAngle(i) + angleStep * f);
+			}
+		});
 	}
+	bufferFrames[nextBuffer] = frame;
+	nextBuffer = (nextBuffer + 1) % numBuffers;
+
+	// Hydra's change tracking stops at the primvar: only the rotations are dirty, the
+	// instance indices, translations and scales are left alone
+	_valueCache.Set(instancerPath, pxr::HdInstancerTokens->rotate, pxr::VtValue(rotate));
+	GetRenderIndex().GetChangeTracker().MarkInstancerDirty(instancerPath, pxr::HdChangeTracker::DirtyPrimvar);
+}
 
-	return indices;
+pxr::VtIntArray SceneDelegate::GetInstanceIndices(pxr::SdfPath const &instancerId, pxr::SdfPath const &prototypeId)
+{
+	DELEGATE_LOG << "[" << instancerId.GetString() <<"][GetInstanceIndices]:" << prototypeId << std::endl;
+	return instanceIndices;
 
 }
 
 pxr::GfMatrix4d SceneDelegate::GetInstancerTransform(pxr::SdfPath const &instancerId, pxr::SdfPath const &prototypeId)
 {
-	std::cout << "[" << instancerId.GetString() <<"][GetInstancerTransform]:" << prototypeId << std::endl;
+	DELEGATE_LOG << "[" << instancerId.GetString() <<"][GetInstancerTransform]:" << prototypeId << std::endl;
 	return pxr::GfMatrix4d(1.0);
 }
 
@@ -281,69 +304,33 @@ pxr::SdfPath SceneDelegate::GetPathForInstanceIndex(const pxr::SdfPath &protoPri
 									   pxr::SdfPath *rprimPath,
 									   pxr::SdfPathVector *instanceContext)
 {
-	std::cout << "[" << protoPrimPath.GetString() <<"][GetPathForInstanceIndex]:" << instanceIndex << std::endl;
-	pxr::VtIntArray tmp;//
+	DELEGATE_LOG << "[" << protoPrimPath.GetString() <<"][GetPathForInstanceIndex]:" << instanceIndex << std::endl;
 
-	int index = 0;
-	for (int i = 0; i < 10; ++i)
+	// absoluteInstanceIndex points to a single int. There is one level of
+	// instancing and the indices are the identity, so the instance index is
+	// already absolute.
+	if (instanceIndex < 0 || instanceIndex >= instanceCount)
 	{
-		for (int j = 0; j < 10; ++j)
-		{
-			absoluteInstanceIndex[index] = index;
-			index++;
-		}
+		return pxr::SdfPath();
 	}
-
-	return pxr::SdfPath();
+	if (absoluteInstanceIndex)
+	{
+		*absoluteInstanceIndex = instanceIndex;
+	}
+	if (rprimPath)
+	{
+		*rprimPath = protoPrimPath;
+	}
+	return instancerPath;
 }
 
 pxr::HdMeshTopology SceneDelegate::GetMeshTopology(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Topology]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Topology]" << std::endl;
 
 	if ( id == pxr::SdfPath("/cube") )
 	{
-		pxr::VtArray<int> vertCountsPerFace;
-		pxr::VtArray<int> verts;
-		vertCountsPerFace.push_back(4);
-		vertCountsPerFace.push_back(4);
-		vertCountsPerFace.push_back(4);
-		vertCountsPerFace.push_back(4);
-		vertCountsPerFace.push_back(4);
-		vertCountsPerFace.push_back(4);
-
-		verts.push_back(0);
-		verts.push_back(3);
-		verts.push_back(2);
-		verts.push_back(1);
-
-		verts.push_back(4);
-		verts.push_back(5);
-		verts.push_back(6);
-		verts.push_back(7);
-
-		verts.push_back(1);
-		verts.push_back(2);
-		verts.push_back(6);
-		verts.push_back(5);
-
-		verts.push_back(2);
-		verts.push_back(3);
-		verts.push_back(7);
-		verts.push_back(6);
-
-		verts.push_back(3);
-		verts.push_back(0);
-		verts.push_back(4);
-		verts.push_back(7);
-
-		verts.push_back(0);
-		verts.push_back(1);
-		verts.push_back(5);
-		verts.push_back(4);
-
-		pxr::HdMeshTopology topology(pxr::PxOsdOpenSubdivTokens->none, pxr::HdTokens->rightHanded,
-									 vertCountsPerFace, verts);
-		return topology;
+		return cubeTopology;
 	}
+	return pxr::HdMeshTopology();
 }
@@ -2,11 +2,17 @@
 
 #include "pxr/imaging/hd/sceneDelegate.h"
 
+#include "ValueCache.h"
+
 
 class SceneDelegate : public pxr::HdSceneDelegate
 {
 public:
-	SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const& delegateID);
+	// numInstances cubes, of which numUpdatesPerFrame turn each frame
+	SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const& delegateID,
+				  int numInstances = 100, int numUpdatesPerFrame = 0);
+
+	static constexpr int maxInstances = 10000000;
 
 	void AddRenderTask(pxr::SdfPath const &id);
 	void AddRenderSetupTask(pxr::SdfPath const &id);
@@ -14,6 +20,10 @@ public:
 	void SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix);
 	void SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix);
 
+	// Make the parameter edits since the last call visible to Hydra, once
+	// per frame before HdEngine::Execute.
+	void PublishEdits() { _valueCache.Publish(); }
+
 	// interface Hydra uses query information from the SceneDelegate when processing an 
 	// Prim in the RenderIndex
 	pxr::VtValue Get(pxr::SdfPath const &id, const pxr::TfToken &key) override;
@@ -23,7 +33,6 @@ public:
 	pxr::GfMatrix4d GetTransform(pxr::SdfPath const &id) override;
 
 	pxr::HdPrimvarDescriptorVector GetPrimvarDescriptors(pxr::SdfPath const& id, pxr::HdInterpolation interpolation) override;
-	//pxr::TfTokenVector GetPrimVarInstanceNames(pxr::SdfPath const &id) override;
 
 	void UpdateTransform();
 
@@ -38,12 +47,24 @@ public:
 	pxr::HdMeshTopology GetMeshTopology(pxr::SdfPath const &id) override;
 
 private:
-	// per location (SdfPath) cache of dictionaries (TfToken -> VtValue) 
-	typedef pxr::TfHashMap<pxr::TfToken, pxr::VtValue, pxr::TfToken::HashFunctor> _ValueCache;
-	typedef pxr::TfHashMap<pxr::SdfPath, _ValueCache, pxr::SdfPath::Hash> _ValueCacheMap;
-	_ValueCacheMap _valueCacheMap;
+	// (path, key) -> value, read lock-free by Hydra's Sync
+	ValueCache _valueCache;
 
 	// location of Camera (setup in ctor)
 	pxr::SdfPath cameraPath;
 	float rotation;
+
+	pxr::SdfPath instancerPath;
+	const int instanceCount;
+	const int updatesPerFrame;
+	pxr::VtIntArray instanceIndices;
+	pxr::HdMeshTopology cubeTopology;
+
+	// the rotate primvar is written into these in turn, bufferFrames holds
+	// the frame each one is up to date with
+	static constexpr int numBuffers = 3;
+	pxr::VtVec4fArray rotateBuffers[numBuffers];
+	int bufferFrames[numBuffers];
+	int frame;
+	int nextBuffer;
 };
\ No newline at end of file
@@ -22,12 +22,14 @@
 
 #include "SceneDelegate.h"
 
+#include <cstdlib>
+
 
 
 class DebugWindow : public pxr::GarchGLDebugWindow
 {
 public:
-	DebugWindow(const char *title, int width, int height) : GarchGLDebugWindow(title, width, height)
+	DebugWindow(const char *title, int width, int height, int numInstances, int numUpdatesPerFrame) : GarchGLDebugWindow(title, width, height)
 	{
 		// create a RenderDelegate which is required for the RenderIndex
 		renderDelegate.reset( new pxr::HdStRenderDelegate() );
@@ -41,7 +43,7 @@ public:
 		pxr::SdfPath sceneId("/");
 
 		// SceneDelegate can query information from the client SceneGraph to update the renderer
-		sceneDelegate = new SceneDelegate( index, sceneId );
+		sceneDelegate = new SceneDelegate( index, sceneId, numInstances, numUpdatesPerFrame );
 
 		// Create two tasks (render setup & render) to the RenderIndex
 		sceneDelegate->AddRenderSetupTask(renderSetupId);
@@ -67,6 +69,9 @@ public:
 
 		sceneDelegate->UpdateTransform();
 
+		// parameter edits made since the last frame
+		sceneDelegate->PublishEdits();
+
 		// execute the render tasks
 		engine.Execute( *index, tasks );
 	}
@@ -84,8 +89,20 @@ int main(int argc, char** argv)
 	//pxr::TfDebug::Enable(pxr::HD_MDI);
 	//pxr::TfDebug::Enable(pxr::HD_DUMP_SHADER_SOURCE);
 
+	// instancing [instances [updates per frame]], e.g. instancing 1000000 10000
+	int numInstances = 100;
+	int numUpdatesPerFrame = 0;
+	if (argc > 1)
+	{
+		numInstances = atoi(argv[1]);
+	}
+	if (argc > 2)
+	{
+		numUpdatesPerFrame = atoi(argv[2]);
+	}
+
 	// create a window, GLContext & extensions
-	DebugWindow window("hydra - instancing", 1280, 720);
+	DebugWindow window("hydra - instancing", 1280, 720, numInstances, numUpdatesPerFrame);
 	window.Init();
 	bool glewInit = pxr::GlfGlewInit();
 	std::cout << "glew:" << glewInit << std::endl;
@@ -70,6 +70,9 @@ public:
 		glDepthFunc(GL_LESS);
 		glEnable(GL_DEPTH_TEST);
 
+		// parameter edits made since the last frame
+		sceneDelegate->PublishEdits();
+
 		// execute the render tasks
 		engine.Execute( *index, tasks );
 	}
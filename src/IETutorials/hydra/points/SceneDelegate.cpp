@@ -1,4 +1,5 @@
 #include "SceneDelegate.h"
+#include "DelegateLog.h"
 
 #include "pxr/imaging/hd/camera.h"
 #include "pxr/imaging/cameraUtil/conformWindow.h"
@@ -10,9 +11,13 @@
 #include "pxr/base/gf/frustum.h"
 #include "pxr/base/vt/array.h"
 
+#include <algorithm>
+#include <vector>
+
 
 SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const &delegateID)
- : pxr::HdSceneDelegate(parentIndex, delegateID)
+ : pxr::HdSceneDelegate(parentIndex, delegateID),
+  rotation(0.0f)
 {
 	cameraPath = pxr::SdfPath("/camera");
 	GetRenderIndex().InsertSprim(pxr::HdPrimTypeTokens->camera, this, cameraPath);
@@ -22,28 +27,43 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
 
 	GetRenderIndex().InsertRprim(pxr::HdPrimTypeTokens->points, this, pxr::SdfPath("/points") );
 
+	// The lattice never moves: generate it once, every Get() shares the array.
+	const float cellSize = size / arraySize;
+	pxr::VtVec3fArray points(arraySize * arraySize * arraySize);
+	size_t index = 0;
+	for (int i = 0; i < arraySize; ++i)
+	{
+		for (int j = 0; j < arraySize; ++j)
+		{
+			for (int k = 0; k < arraySize; ++k)
+			{
+				points[index++] = pxr::GfVec3f(i * cellSize, j * cellSize , k * cellSize) - pxr::GfVec3f(0.5f * size, 0.5f *size, 0.5f *size);
+			}
+		}
+	}
+	_valueCache.Set(pxr::SdfPath("/points"), pxr::HdTokens->points, pxr::VtValue(points));
+
+	UpdateWidths();
 }
 
 void
 SceneDelegate::AddRenderTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->collection]
-			= pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->collection,
+			pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull));
 }
 
 void
 SceneDelegate::AddRenderSetupTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderSetupTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
 	pxr::HdxRenderTaskParams params;
 	params.camera = cameraPath;
 	params.viewport = pxr::GfVec4f(0, 0, 512, 512);
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->params] = pxr::VtValue(params);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->params, pxr::VtValue(params));
 }
 
 void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
@@ -53,10 +73,9 @@ void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d
 
 void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
 {
-	_ValueCache &cache = _valueCacheMap[cameraId];
-	cache[pxr::HdCameraTokens->windowPolicy] = pxr::VtValue(pxr::CameraUtilFit);
-	cache[pxr::HdCameraTokens->worldToViewMatrix] = pxr::VtValue(viewMatrix);
-	cache[pxr::HdCameraTokens->projectionMatrix] = pxr::VtValue(projMatrix);
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->windowPolicy, pxr::VtValue(pxr::CameraUtilFit));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->worldToViewMatrix, pxr::VtValue(viewMatrix));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->projectionMatrix, pxr::VtValue(projMatrix));
 
 	GetRenderIndex().GetChangeTracker().MarkSprimDirty(cameraId, pxr::HdCamera::AllDirty);
 }
@@ -64,10 +83,9 @@ void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d cons
 
 pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 {
-	std::cout << "[" << id.GetString() <<"][" << key << "]" << std::endl;
-	_ValueCache *vcache = pxr::TfMapLookupPtr(_valueCacheMap, id);
+	DELEGATE_LOG << "[" << id.GetString() <<"][" << key << "]" << std::endl;
 	pxr::VtValue ret;
-	if (vcache && pxr::TfMapLookup(*vcache, key, &ret)) {
+	if (_valueCache.Find(id, key, &ret)) {
 		return ret;
 	}
 
@@ -76,69 +94,25 @@ pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 		return pxr::VtValue();
 	}
 
-	const int arraySize = 20;
-	const float size = 2.0;
-
-	const float cellSize = size / arraySize;
-
-	if (key == pxr::HdTokens->points)
-	{
-		pxr::VtVec3fArray points;
-
-		for (size_t i = 0; i < arraySize; ++i)
-		{
-			for (size_t j = 0; j < arraySize; ++j)
-			{
-				for (size_t k = 0; k < arraySize; ++k)
-				{
-					points.push_back(pxr::GfVec3f(i * cellSize, j * cellSize , k * cellSize) - pxr::GfVec3f(0.5f * size, 0.5f *size, 0.5f *size));
-				}
-			}
-		}
-
-
-		return pxr::VtValue(points);
-	}
-
-	if (key == pxr::HdTokens->widths)
-	{
-		pxr::VtFloatArray widths;
-
-		for (size_t i = 0; i < arraySize; ++i)
-		{
-			for (size_t j = 0; j < arraySize; ++j)
-			{
-				for (size_t k = 0; k < arraySize; ++k)
-				{
-					float a = 0.3f * sin((float) j * 0.2f + rotation * 0.01f);
-					a *= a;
-
-					widths.push_back(0.02f + a  );
-				}
-			}
-		}
-
-		return pxr::VtValue(widths);
-	}
-
+	// points and widths are in _valueCache
 	return pxr::VtValue();
 }
 
 bool SceneDelegate::GetVisible(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Visible]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Visible]" << std::endl;
 	return true;
 }
 
 pxr::GfRange3d SceneDelegate::GetExtent(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Extent]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Extent]" << std::endl;
 	return pxr::GfRange3d(pxr::GfVec3d(-1,-1,-1), pxr::GfVec3d(1,1,1));
 }
 
 pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Transform]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Transform]" << std::endl;
 	if (id == pxr::SdfPath("/points") )
 	{
 		pxr::GfMatrix4d m ;
@@ -149,7 +123,7 @@ pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 
 pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath const& id, pxr::HdInterpolation interpolation)
 {
-	std::cout << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
 	pxr::HdPrimvarDescriptorVector primvarDescriptors;
 
 	if (interpolation == pxr::HdInterpolation::HdInterpolationVertex)
@@ -162,9 +136,35 @@ pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath
 	return primvarDescriptors;
 }
 
+void SceneDelegate::UpdateWidths()
+{
+	// a width per j row, the same for every i and k
+	std::vector<float> rowWidths(arraySize);
+	for (int j = 0; j < arraySize; ++j)
+	{
+		float a = 0.3f * sin((float) j * 0.2f + rotation * 0.01f);
+		a *= a;
+		rowWidths[j] = 0.02f + a;
+	}
+
+	// A new array, the one published for the frame in flight is still shared.
+	pxr::VtFloatArray widths(arraySize * arraySize * arraySize);
+	size_t index = 0;
+	for (int i = 0; i < arraySize; ++i)
+	{
+		for (int j = 0; j < arraySize; ++j)
+		{
+			std::fill_n(widths.data() + index, arraySize, rowWidths[j]);
+			index += arraySize;
+		}
+	}
+	_valueCache.Set(pxr::SdfPath("/points"), pxr::HdTokens->widths, pxr::VtValue(widths));
+}
+
 void SceneDelegate::UpdateTransform()
 {
 	rotation += 1.0f;
+	UpdateWidths();
 
 	GetRenderIndex().GetChangeTracker().MarkRprimDirty(pxr::SdfPath("/points"), pxr::HdChangeTracker::DirtyTransform | pxr::HdChangeTracker::DirtyWidths);
 }
\ No newline at end of file
@@ -67,6 +67,9 @@ public:
 
 		sceneDelegate->UpdateTransform();
 
+		// parameter edits made since the last frame
+		sceneDelegate->PublishEdits();
+
 		// execute the render tasks
 		engine.Execute( *index, tasks );
 	}
@@ -1,4 +1,5 @@
 #include "SceneDelegate.h"
+#include "DelegateLog.h"
 
 #include "pxr/imaging/hd/camera.h"
 #include "pxr/imaging/hdSt/light.h"
@@ -31,6 +32,15 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
 	GetRenderIndex().InsertRprim(pxr::HdPrimTypeTokens->mesh, this, pxr::SdfPath("/cube") );
 	GetRenderIndex().InsertRprim(pxr::HdPrimTypeTokens->mesh, this, pxr::SdfPath("/plane") );
 
+	// the plane never changes, the cube's points are rebuilt as time advances
+	pxr::VtVec3fArray planePoints(4);
+	planePoints[0] = pxr::GfVec3f(-10,0,-10);
+	planePoints[1] = pxr::GfVec3f(-10,0,10);
+	planePoints[2] = pxr::GfVec3f(10,0,10);
+	planePoints[3] = pxr::GfVec3f(10,0,-10);
+	_valueCache.Set(pxr::SdfPath("/plane"), pxr::HdTokens->points, pxr::VtValue(planePoints));
+	UpdateCubePoints();
+
 	// prep lights
 	pxr::GlfSimpleLight light1;
 
@@ -50,7 +60,6 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
 
 	auto path = pxr::SdfPath("/light1");
 	GetRenderIndex().InsertSprim(pxr::HdPrimTypeTokens->simpleLight, this, path);
-	_ValueCache &cache = _valueCacheMap[path];
 
 	pxr::HdxShadowParams shadowParams;
 	shadowParams.enabled = false;
@@ -58,42 +67,39 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
 	shadowParams.bias = -0.001;
 	shadowParams.blur = 0.1;
 
-	cache[pxr::HdLightTokens->params] = light1;
-	cache[pxr::HdLightTokens->shadowParams] = shadowParams;
-	cache[pxr::HdLightTokens->shadowCollection] = pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->refined);
+	_valueCache.Set(path, pxr::HdLightTokens->params, light1);
+	_valueCache.Set(path, pxr::HdLightTokens->shadowParams, shadowParams);
+	_valueCache.Set(path, pxr::HdLightTokens->shadowCollection, pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->refined));
 }
 
 void SceneDelegate::AddRenderTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->collection] = pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->refined);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->collection, pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->refined));
 }
 
 void SceneDelegate::AddRenderSetupTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderSetupTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
 	pxr::HdxRenderTaskParams params;
 	params.enableLighting = true;
 	params.enableHardwareShading = true;
 	params.camera = cameraPath;
 	params.viewport = pxr::GfVec4f(0, 0, 512, 512);
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->params] = pxr::VtValue(params);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->params, pxr::VtValue(params));
 }
 
 void SceneDelegate::AddSimpleLightTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxSimpleLightTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
 	pxr::HdxSimpleLightTaskParams params;
 	params.cameraPath = cameraPath;
 	params.viewport = pxr::GfVec4f(0,0,512,512);
 
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->params] = pxr::VtValue(params);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->params, pxr::VtValue(params));
 
 }
 void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
@@ -103,10 +109,9 @@ void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d
 
 void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
 {
-	_ValueCache &cache = _valueCacheMap[cameraId];
-	cache[pxr::HdCameraTokens->windowPolicy] = pxr::VtValue(pxr::CameraUtilFit);
-	cache[pxr::HdCameraTokens->worldToViewMatrix] = pxr::VtValue(viewMatrix);
-	cache[pxr::HdCameraTokens->projectionMatrix] = pxr::VtValue(projMatrix);
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->windowPolicy, pxr::VtValue(pxr::CameraUtilFit));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->worldToViewMatrix, pxr::VtValue(viewMatrix));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->projectionMatrix, pxr::VtValue(projMatrix));
 
 	GetRenderIndex().GetChangeTracker().MarkSprimDirty(cameraId, pxr::HdCamera::AllDirty);
 }
@@ -114,10 +119,9 @@ void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d cons
 
 pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 {
-	//std::cout << "Get-" << "[" << id.GetString() <<"][" << key << "]" << std::endl;
-	_ValueCache *vcache = pxr::TfMapLookupPtr(_valueCacheMap, id);
+	DELEGATE_LOG << "Get-" << "[" << id.GetString() <<"][" << key << "]" << std::endl;
 	pxr::VtValue ret;
-	if (vcache && pxr::TfMapLookup(*vcache, key, &ret)) {
+	if (_valueCache.Find(id, key, &ret)) {
 		return ret;
 	}
 
@@ -126,55 +130,19 @@ pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 		return pxr::VtValue();
 	}
 
-	if (id == pxr::SdfPath("/cube"))
+	if (key == pxr::HdTokens->color)
 	{
-		if (key == pxr::HdTokens->color)
+		if (id == pxr::SdfPath("/cube"))
 		{
 			return pxr::VtValue(pxr::GfVec4f(0.3, 0.2, 0.2, 1.0));
 		}
-		if (key == pxr::HdTokens->points)
-		{
-			pxr::VtVec3fArray points;
-
-			points.push_back(pxr::GfVec3f(0,0,0));
-			points.push_back(pxr::GfVec3f(5.0f * sin(time) * sin(time),0,0));
-			points.push_back(pxr::GfVec3f(1,1,0));
-			points.push_back(pxr::GfVec3f(0,1,0));
-
-			points.push_back(pxr::GfVec3f(0,0,5.0f * cos(time) * cos(time)));
-			points.push_back(pxr::GfVec3f(1,0,1));
-			points.push_back(pxr::GfVec3f(1,1,1));
-			points.push_back(pxr::GfVec3f(0,1,1));
-
-			for (size_t i = 0; i < points.size(); ++i)
-			{
-				points[i] -= pxr::GfVec3f(0.5f, 0.5f, 0.5f);
-			}
-			return pxr::VtValue(points);
-		}
-
-	}
-	else if (id == pxr::SdfPath("/plane"))
-	{
-		if (key == pxr::HdTokens->color)
+		if (id == pxr::SdfPath("/plane"))
 		{
 			return pxr::VtValue(pxr::GfVec4f(0.2, 0.3, 0.2, 1.0));
 		}
-		if (key == pxr::HdTokens->points)
-		{
-			pxr::VtVec3fArray points;
-
-			points.push_back(pxr::GfVec3f(-10,0,-10));
-			points.push_back(pxr::GfVec3f(-10,0,10));
-			points.push_back(pxr::GfVec3f(10,0,10));
-			points.push_back(pxr::GfVec3f(10,0,-10));
-			return pxr::VtValue(points);
-		}
-
-
 	}
 
-
+	// points are in _valueCache
 	return pxr::VtValue();
 }
 
@@ -188,19 +156,19 @@ pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 
 bool SceneDelegate::GetVisible(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Visible]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Visible]" << std::endl;
 	return true;
 }
 
 pxr::GfRange3d SceneDelegate::GetExtent(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Extent]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Extent]" << std::endl;
 	return pxr::GfRange3d(pxr::GfVec3d(-1,-1,-1), pxr::GfVec3d(1,1,1));
 }
 
 pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 {
-	//std::cout << "[" << id.GetString() <<"][Transform]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Transform]" << std::endl;
 
 	if (id == pxr::SdfPath("/cube") )
 	{
@@ -214,7 +182,7 @@ pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 
 pxr::HdMeshTopology SceneDelegate::GetMeshTopology(pxr::SdfPath const &id)
 {
-	//std::cout << "[" << id.GetString() <<"][Topology]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Topology]" << std::endl;
 
 	if ( id == pxr::SdfPath("/plane"))
 	{
@@ -279,7 +247,7 @@ pxr::HdMeshTopology SceneDelegate::GetMeshTopology(pxr::SdfPath const &id)
 
 pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath const& id, pxr::HdInterpolation interpolation)
 {
-	std::cout << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
 	pxr::HdPrimvarDescriptorVector primvarDescriptors;
 
 	if (interpolation == pxr::HdInterpolation::HdInterpolationVertex)
@@ -322,10 +290,32 @@ void SceneDelegate::UpdateCubeTransform()
 {
 	//rotation += 0.1f;
 	time += 0.001f;
+	UpdateCubePoints();
 	GetRenderIndex().GetChangeTracker().MarkRprimDirty(pxr::SdfPath("/cube"), pxr::HdChangeTracker::DirtyTransform | pxr::HdChangeTracker::DirtyPoints);
 }
 
 int SceneDelegate::GetRefineLevel(pxr::SdfPath const& id)
 {
 	return 5;
-}
\ No newline at end of file
+}
+
+void SceneDelegate::UpdateCubePoints()
+{
+	// a new array each time: the one Hydra may still be reading is left alone
+	pxr::VtVec3fArray points(8);
+	points[0] = pxr::GfVec3f(0,0,0);
+	points[1] = pxr::GfVec3f(5.0f * sin(time) * sin(time),0,0);
+	points[2] = pxr::GfVec3f(1,1,0);
+	points[3] = pxr::GfVec3f(0,1,0);
+
+	points[4] = pxr::GfVec3f(0,0,5.0f * cos(time) * cos(time));
+	points[5] = pxr::GfVec3f(1,0,1);
+	points[6] = pxr::GfVec3f(1,1,1);
+	points[7] = pxr::GfVec3f(0,1,1);
+
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		points[i] -= pxr::GfVec3f(0.5f, 0.5f, 0.5f);
+	}
+	_valueCache.Set(pxr::SdfPath("/cube"), pxr::HdTokens->points, pxr::VtValue(points));
+}
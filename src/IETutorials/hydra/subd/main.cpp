@@ -72,6 +72,9 @@ public:
 
 		glPolygonMode( GL_FRONT_AND_BACK, GL_LINE);
 
+		// parameter edits made since the last frame
+		sceneDelegate->PublishEdits();
+
 		// execute the render tasks
 		engine.Execute( *index, tasks );
 	}
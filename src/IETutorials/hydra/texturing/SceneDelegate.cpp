@@ -1,4 +1,5 @@
 #include "SceneDelegate.h"
+#include "DelegateLog.h"
 
 #include <fstream>
 
@@ -29,29 +30,42 @@ SceneDelegate::SceneDelegate(pxr::HdRenderIndex *parentIndex, pxr::SdfPath const
 	GetRenderIndex().InsertRprim(pxr::HdPrimTypeTokens->mesh, this, pxr::SdfPath("/quad") );
 	// add a shader
 	GetRenderIndex().InsertSprim(pxr::HdPrimTypeTokens->material, this, pxr::SdfPath("/shader") );
+
+	// the quad never changes, so Get() serves one shared copy
+	pxr::VtVec3fArray points(4);
+	points[0] = pxr::GfVec3f(-1,-1,0);
+	points[1] = pxr::GfVec3f(1,-1,0);
+	points[2] = pxr::GfVec3f(1,1,0);
+	points[3] = pxr::GfVec3f(-1,1,0);
+	_valueCache.Set(pxr::SdfPath("/quad"), pxr::HdTokens->points, pxr::VtValue(points));
+
+	pxr::VtVec2fArray uvs(4);
+	uvs[0] = pxr::GfVec2f(0,0);
+	uvs[1] = pxr::GfVec2f(1,0);
+	uvs[2] = pxr::GfVec2f(1,1);
+	uvs[3] = pxr::GfVec2f(0,1);
+	_valueCache.Set(pxr::SdfPath("/quad"), pxr::TfToken("uv"), pxr::VtValue(uvs));
 }
 
 void
 SceneDelegate::AddRenderTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->collection]
-			= pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->collection,
+			pxr::HdRprimCollection(pxr::HdTokens->geometry, pxr::HdTokens->smoothHull));
 }
 
 void
 SceneDelegate::AddRenderSetupTask(pxr::SdfPath const &id)
 {
 	GetRenderIndex().InsertTask<pxr::HdxRenderSetupTask>(this, id);
-	_ValueCache &cache = _valueCacheMap[id];
 	pxr::HdxRenderTaskParams params;
 	params.enableLighting = true;
 	params.camera = cameraPath;
 	params.viewport = pxr::GfVec4f(0, 0, 512, 512);
-	cache[pxr::HdTokens->children] = pxr::VtValue(pxr::SdfPathVector());
-	cache[pxr::HdTokens->params] = pxr::VtValue(params);
+	_valueCache.Set(id, pxr::HdTokens->children, pxr::VtValue(pxr::SdfPathVector()));
+	_valueCache.Set(id, pxr::HdTokens->params, pxr::VtValue(params));
 }
 
 void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
@@ -61,10 +75,9 @@ void SceneDelegate::SetCamera(pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d
 
 void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d const &viewMatrix, pxr::GfMatrix4d const &projMatrix)
 {
-	_ValueCache &cache = _valueCacheMap[cameraId];
-	cache[pxr::HdCameraTokens->windowPolicy] = pxr::VtValue(pxr::CameraUtilFit);
-	cache[pxr::HdCameraTokens->worldToViewMatrix] = pxr::VtValue(viewMatrix);
-	cache[pxr::HdCameraTokens->projectionMatrix] = pxr::VtValue(projMatrix);
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->windowPolicy, pxr::VtValue(pxr::CameraUtilFit));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->worldToViewMatrix, pxr::VtValue(viewMatrix));
+	_valueCache.Set(cameraId, pxr::HdCameraTokens->projectionMatrix, pxr::VtValue(projMatrix));
 
 	GetRenderIndex().GetChangeTracker().MarkSprimDirty(cameraId, pxr::HdCamera::AllDirty);
 }
@@ -72,10 +85,9 @@ void SceneDelegate::SetCamera(pxr::SdfPath const &cameraId, pxr::GfMatrix4d cons
 
 pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 {
-	std::cout << "[" << id.GetString() <<"][" << key << "]" << std::endl;
-	_ValueCache *vcache = pxr::TfMapLookupPtr(_valueCacheMap, id);
+	DELEGATE_LOG << "[" << id.GetString() <<"][" << key << "]" << std::endl;
 	pxr::VtValue ret;
-	if (vcache && pxr::TfMapLookup(*vcache, key, &ret)) {
+	if (_valueCache.Find(id, key, &ret)) {
 		return ret;
 	}
 
@@ -84,27 +96,6 @@ pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 		return pxr::VtValue(pxr::SdfPath("/shader"));
 	}
 
-	if (key == pxr::HdTokens->points)
-	{
-		pxr::VtVec3fArray points;
-
-		points.push_back(pxr::GfVec3f(-1,-1,0));
-		points.push_back(pxr::GfVec3f(1,-1,0));
-		points.push_back(pxr::GfVec3f(1,1,0));
-		points.push_back(pxr::GfVec3f(-1,1,0));
-		return pxr::VtValue(points);
-	}
-	if (key == pxr::TfToken("uv"))
-	{
-		pxr::VtVec2fArray uvs;
-
-		uvs.push_back(pxr::GfVec2f(0,0));
-		uvs.push_back(pxr::GfVec2f(1,0));
-		uvs.push_back(pxr::GfVec2f(1,1));
-		uvs.push_back(pxr::GfVec2f(0,1));
-
-		return pxr::VtValue(uvs);
-	}
 	if (key == pxr::HdTokens->color)
 	{
 		return pxr::VtValue(pxr::GfVec4f(0.9f, 0.9f, 0.9f, 1.0));
@@ -115,25 +106,25 @@ pxr::VtValue SceneDelegate::Get(pxr::SdfPath const &id, const pxr::TfToken &key)
 
 bool SceneDelegate::GetVisible(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Visible]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Visible]" << std::endl;
 	return true;
 }
 
 pxr::GfRange3d SceneDelegate::GetExtent(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Extent]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Extent]" << std::endl;
 	return pxr::GfRange3d(pxr::GfVec3d(-1,-1,-1), pxr::GfVec3d(1,1,1));
 }
 
 pxr::GfMatrix4d SceneDelegate::GetTransform(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Transform]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Transform]" << std::endl;
 	return pxr::GfMatrix4d(1.0f);
 }
 
 pxr::HdMeshTopology SceneDelegate::GetMeshTopology(pxr::SdfPath const &id)
 {
-	std::cout << "[" << id.GetString() <<"][Topology]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][Topology]" << std::endl;
 	pxr::VtArray<int> vertCountsPerFace;
 	pxr::VtArray<int> verts;
 	vertCountsPerFace.push_back(4);
@@ -150,7 +141,7 @@ pxr::HdMeshTopology SceneDelegate::GetMeshTopology(pxr::SdfPath const &id)
 
 pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath const& id, pxr::HdInterpolation interpolation)
 {
-	std::cout << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
+	DELEGATE_LOG << "[" << id.GetString() <<"][GetPrimvarDescriptors]" << std::endl;
 	pxr::HdPrimvarDescriptorVector primvarDescriptors;
 
 	if (interpolation == pxr::HdInterpolation::HdInterpolationVertex)
@@ -170,7 +161,7 @@ pxr::HdPrimvarDescriptorVector SceneDelegate::GetPrimvarDescriptors(pxr::SdfPath
 
 std::string SceneDelegate::GetSurfaceShaderSource(pxr::SdfPath const &shaderId)
 {
-	std::cout << "[" << shaderId.GetString() <<"][GetSurfaceShaderSource]" << std::endl;
+	DELEGATE_LOG << "[" << shaderId.GetString() <<"][GetSurfaceShaderSource]" << std::endl;
 
 	// render the UVs
 	//return "vec4 surfaceShader(vec4 Peye, vec3 Neye, vec4 color, vec4 patchCoord) { return vec4(HdGet_uv().x, HdGet_uv().y, 0, 1) * color; }";
@@ -181,20 +172,20 @@ std::string SceneDelegate::GetSurfaceShaderSource(pxr::SdfPath const &shaderId)
 
 std::string SceneDelegate::GetDisplacementShaderSource(pxr::SdfPath const &shaderId)
 {
-	std::cout << "[" << shaderId.GetString() <<"][GetDisplacementShaderSource]" << std::endl;
+	DELEGATE_LOG << "[" << shaderId.GetString() <<"][GetDisplacementShaderSource]" << std::endl;
 	return "vec4 displacementShader(int  a, vec4 b, vec3 c, vec4 d) { return b; }";
 }
 
 pxr::VtValue SceneDelegate::GetMaterialParamValue(pxr::SdfPath const &shaderId, const pxr::TfToken &paramName)
 {
-	std::cout << "[" << shaderId.GetString() << "." << paramName <<"][GetSurfaceShaderParamValue]" << std::endl;
+	DELEGATE_LOG << "[" << shaderId.GetString() << "." << paramName <<"][GetSurfaceShaderParamValue]" << std::endl;
 
 	return  pxr::VtValue();
 }
 
 pxr::HdMaterialParamVector SceneDelegate::GetMaterialParams(pxr::SdfPath const &shaderId)
 {
-	std::cout << "[" << shaderId.GetString() <<"][GetSurfaceShaderParams]" << std::endl;
+	DELEGATE_LOG << "[" << shaderId.GetString() <<"][GetSurfaceShaderParams]" << std::endl;
 
 	pxr::HdMaterialParamVector r;
 	pxr::HdMaterialParam param(pxr::TfToken("textureColor"),  pxr::VtValue(pxr::GfVec4f(0.9f, 0.9f, 0.9f, 1.0)), pxr::SdfPath("/texture") );
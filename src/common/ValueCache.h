@@ -0,0 +1,162 @@
+#pragma once
+
+#include "pxr/base/tf/token.h"
+#include "pxr/base/vt/value.h"
+#include "pxr/usd/sdf/path.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// The parameters a SceneDelegate hands to Hydra, keyed by (path, key).
+//
+// Hydra calls SceneDelegate::Get from many threads at once during Sync. Reads
+// go to an immutable snapshot, a flat open-addressing table, reached with a
+// single atomic load and no lock. Find() copies the value out, so reading an
+// array still bumps that array's reference count; only threads reading the
+// same key contend on it.
+//
+// Shared by the IETutorials scene delegates and hd_sample, which calls it
+// Hdx_UnitTestValueCache.
+//
+// Set() stages an edit, from any thread, even while a frame is syncing.
+// Publish() makes the staged edits visible by swapping in a new snapshot;
+// call it once per frame, before HdEngine::Execute, from the thread that
+// calls Execute. A replaced snapshot is freed by the following Publish(), by
+// which time the frame that could still be reading it is over.
+class ValueCache
+{
+public:
+	ValueCache() : _current(nullptr) {}
+	ValueCache(const ValueCache &) = delete;
+	ValueCache &operator=(const ValueCache &) = delete;
+
+	bool Find(pxr::SdfPath const &path, pxr::TfToken const &key, pxr::VtValue *value) const
+	{
+		const Snapshot *snapshot = _current.load(std::memory_order_acquire);
+		const Entry *entry = snapshot ? snapshot->Find(path, key) : nullptr;
+		if (!entry)
+			return false;
+		*value = entry->value;
+		return true;
+	}
+
+	void Set(pxr::SdfPath const &path, pxr::TfToken const &key, pxr::VtValue const &value)
+	{
+		std::lock_guard<std::mutex> lock(_stagedMutex);
+		_staged.push_back(Entry{path, key, value});
+	}
+
+	void Publish()
+	{
+		std::vector<Entry> staged;
+		{
+			std::lock_guard<std::mutex> lock(_stagedMutex);
+			staged.swap(_staged);
+		}
+		_retired.reset();
+		if (staged.empty())
+			return;
+
+		std::unique_ptr<Snapshot> next(new Snapshot(_live.get(), staged));
+		_current.store(next.get(), std::memory_order_release);
+		_retired = std::move(_live);
+		_live = std::move(next);
+	}
+
+private:
+	struct Entry
+	{
+		pxr::SdfPath path;
+		pxr::TfToken key;
+		pxr::VtValue value;
+	};
+
+	class Snapshot
+	{
+	public:
+		// previous with staged applied on top, at most half full
+		Snapshot(const Snapshot *previous, std::vector<Entry> &staged)
+		{
+			const size_t count = staged.size() + (previous ? previous->_count : 0);
+			size_t size = 2;
+			_shift = 63;
+			while (size < 2 * count)
+			{
+				size *= 2;
+				--_shift;
+			}
+			_slots.resize(size);
+			if (previous)
+			{
+				for (Entry const &entry : previous->_slots)
+				{
+					if (!entry.path.IsEmpty())
+						_Insert(entry);
+				}
+			}
+			for (Entry &entry : staged)
+			{
+				if (!entry.path.IsEmpty())
+					_Insert(std::move(entry));
+			}
+		}
+
+		const Entry *Find(pxr::SdfPath const &path, pxr::TfToken const &key) const
+		{
+			const size_t mask = _slots.size() - 1;
+			for (size_t i = _Slot(path, key);; i = (i + 1) & mask)
+			{
+				Entry const &entry = _slots[i];
+				if (entry.path.IsEmpty())
+					return nullptr;
+				if (entry.path == path && entry.key == key)
+					return &entry;
+			}
+		}
+
+	private:
+		size_t _Slot(pxr::SdfPath const &path, pxr::TfToken const &key) const
+		{
+			uint64_t h = pxr::SdfPath::Hash()(path);
+			h ^= pxr::TfToken::HashFunctor()(key) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			// Fibonacci hashing: the high bits of the product depend on all
+			// bits of h
+			return size_t((h * 0x9e3779b97f4a7c15ull) >> _shift);
+		}
+
+		void _Insert(Entry entry)
+		{
+			const size_t mask = _slots.size() - 1;
+			for (size_t i = _Slot(entry.path, entry.key);; i = (i + 1) & mask)
+			{
+				Entry &slot = _slots[i];
+				if (slot.path.IsEmpty())
+				{
+					slot = std::move(entry);
+					++_count;
+					return;
+				}
+				if (slot.path == entry.path && slot.key == entry.key)
+				{
+					slot.value = std::move(entry.value);
+					return;
+				}
+			}
+		}
+
+		std::vector<Entry> _slots;
+		size_t _count = 0;
+		int _shift;
+	};
+
+	std::atomic<const Snapshot *> _current;
+	std::unique_ptr<Snapshot> _live;
+	std::unique_ptr<Snapshot> _retired;
+
+	std::mutex _stagedMutex;
+	std::vector<Entry> _staged;
+};
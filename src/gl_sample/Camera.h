@@ -1,25 +1,88 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
 #include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/math.h>
+#include <pxr/base/gf/range3d.h>
 #include <pxr/base/gf/rotation.h>
+#include <stdint.h>
 
 class CameraView {
   float _rotate[2] = {0, 0};
   float _translate[3] = {0.0f, 0.0f, -100.0f};
   int _mousePos[2] = {0, 0};
   bool _mouseButton[3] = {false, false, false};
+  // bumped whenever ViewMatrix() changes
+  uint64_t _version = 0;
 
 public:
-  pxr::GfMatrix4d ViewMatrix() const {
-    pxr::GfMatrix4d viewMatrix(1.0);
-    viewMatrix *= pxr::GfMatrix4d().SetRotate(
+  uint64_t Version() const { return _version; }
+
+  static constexpr double kFieldOfView = 60.0;
+  // Bounds the near plane: no closer than kMinNear, and no closer than
+  // far / kMaxDepthRatio, which is about what a 24-bit depth buffer
+  // resolves.
+  static constexpr double kMinNear = 1e-3;
+  static constexpr double kMaxDepthRatio = 1e4;
+
+  pxr::GfMatrix4d Rotation() const {
+    pxr::GfMatrix4d rotation(1.0);
+    rotation *= pxr::GfMatrix4d().SetRotate(
         pxr::GfRotation(pxr::GfVec3d(0, 1, 0), _rotate[0]));
-    viewMatrix *= pxr::GfMatrix4d().SetRotate(
+    rotation *= pxr::GfMatrix4d().SetRotate(
         pxr::GfRotation(pxr::GfVec3d(1, 0, 0), _rotate[1]));
+    return rotation;
+  }
+
+  pxr::GfMatrix4d ViewMatrix() const {
+    pxr::GfMatrix4d viewMatrix = Rotation();
     viewMatrix *= pxr::GfMatrix4d().SetTranslate(
         pxr::GfVec3d(_translate[0], _translate[1], _translate[2]));
     return viewMatrix;
   }
 
+  // The view volume drawn by GLEngineImpl, in world space. The far plane
+  // encloses bounds tightly, for depth precision. The near plane is
+  // clamped to the minimum, and moved up to the bounds only when the eye
+  // is outside them. Without bounds the planes are 1..100000.
+  pxr::GfFrustum Frustum(double aspectRatio,
+                         const pxr::GfRange3d &bounds = {}) const {
+    pxr::GfFrustum frustum;
+    frustum.SetPositionAndRotationFromMatrix(ViewMatrix().GetInverse());
+    double nearDistance = 1.0;
+    double farDistance = 100000.0;
+    if (!bounds.IsEmpty()) {
+      const double radius = bounds.GetSize().GetLength() * 0.5;
+      const double distance =
+          (bounds.GetMidpoint() - frustum.GetPosition()).GetLength();
+      farDistance = std::max(distance + radius, 2.0 * kMinNear);
+      nearDistance = std::max(kMinNear, farDistance / kMaxDepthRatio);
+      if (distance > radius) {
+        // nothing to draw between the eye and the bounds
+        nearDistance = std::max(nearDistance, distance - radius);
+      }
+    }
+    frustum.SetPerspective(kFieldOfView, aspectRatio, nearDistance,
+                           farDistance);
+    return frustum;
+  }
+
+  // Keep the rotation and move so that bounds fill the view.
+  void Frame(const pxr::GfRange3d &bounds) {
+    if (bounds.IsEmpty()) {
+      return;
+    }
+    const double radius = bounds.GetSize().GetLength() * 0.5;
+    // distance at which the bounding sphere touches the view's edges
+    const double distance =
+        radius / std::sin(pxr::GfDegreesToRadians(kFieldOfView * 0.5));
+    const pxr::GfVec3d center = Rotation().Transform(bounds.GetMidpoint());
+    _translate[0] = float(-center[0]);
+    _translate[1] = float(-center[1]);
+    _translate[2] = float(-center[2] - distance);
+    ++_version;
+  }
+
   void MousePress(int button, int x, int y, int modKeys) {
     _mouseButton[button] = 1;
     _mousePos[0] = x;
@@ -43,6 +106,10 @@ public:
     } else if (_mouseButton[2]) {
       _translate[2] += dx;
     }
+    if ((dx || dy) &&
+        (_mouseButton[0] || _mouseButton[1] || _mouseButton[2])) {
+      ++_version;
+    }
 
     _mousePos[0] = x;
     _mousePos[1] = y;
@@ -0,0 +1,176 @@
+#include "FrameCapture.h"
+#include <cstdio>
+#include <iostream>
+#include <pxr/imaging/hio/image.h>
+
+FrameCapture::FrameCapture(const std::string &path) {
+  // a dot in a directory name is not an extension
+  const size_t slash = path.find_last_of("/\\");
+  size_t dot = path.rfind('.');
+  if (slash != std::string::npos && dot != std::string::npos && dot < slash) {
+    dot = std::string::npos;
+  }
+  _stem = path.substr(0, dot);
+  _extension = dot == std::string::npos ? ".png" : path.substr(dot);
+  _float = _extension == ".exr";
+  _writer = std::thread([this]() { _WriterLoop(); });
+}
+
+FrameCapture::~FrameCapture() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _wakeup.notify_one();
+  if (_writer.joinable()) {
+    _writer.join();
+  }
+}
+
+void FrameCapture::Capture(GLuint framebuffer, int width, int height) {
+  const size_t current = _next;
+  _next = (_next + 1) % RingSize;
+  Readback &readback = _ring[current];
+  // handed over ReadbackLatency frames after it was issued
+  _WaitWritten(readback);
+
+  const GLsizeiptr size =
+      GLsizeiptr(width) * height * (_float ? 4 * sizeof(float) : 4);
+  const GLbitfield access =
+      GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  if (readback.size != size) {
+    // buffer storage is immutable
+    if (readback.buffer) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      glDeleteBuffers(1, &readback.buffer);
+    }
+    glGenBuffers(1, &readback.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glBufferStorage(GL_PIXEL_PACK_BUFFER, size, nullptr, access);
+    readback.mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, access);
+    readback.size = size;
+  } else {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  }
+
+  // With a pack buffer bound this only queues the copy.
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA,
+               _float ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback.width = width;
+  readback.height = height;
+  readback.frame = _frame++;
+  readback.pending = true;
+
+  Readback &ready = _ring[(current + RingSize - ReadbackLatency) % RingSize];
+  if (ready.pending) {
+    _Retire(ready);
+  }
+}
+
+void FrameCapture::_WaitWritten(const Readback &readback) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _written.wait(lock, [&readback]() { return !readback.writing; });
+}
+
+void FrameCapture::_Retire(Readback &readback) {
+  // Normally signaled long ago; blocks only if the GPU is ReadbackLatency
+  // frames behind. The mapping is coherent, so the pixels are visible once
+  // the fence is.
+  glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                   GL_TIMEOUT_IGNORED);
+  glDeleteSync(readback.fence);
+  readback.fence = nullptr;
+  readback.pending = false;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    readback.writing = true;
+    _jobs.push_back(size_t(&readback - _ring.data()));
+  }
+  _wakeup.notify_one();
+}
+
+void FrameCapture::Finish() {
+  // oldest first
+  for (size_t i = 0; i < RingSize; ++i) {
+    Readback &readback = _ring[(_next + i) % RingSize];
+    if (readback.pending) {
+      _Retire(readback);
+    }
+  }
+
+  // The writer reads the mappings until it is done.
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _wakeup.notify_one();
+  if (_writer.joinable()) {
+    _writer.join();
+  }
+
+  for (auto &readback : _ring) {
+    if (readback.buffer) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      glDeleteBuffers(1, &readback.buffer);
+      readback = Readback();
+    }
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+std::string FrameCapture::_GetFileName(uint64_t frame) const {
+  char number[32];
+  std::snprintf(number, sizeof(number), ".%04llu",
+                static_cast<unsigned long long>(frame));
+  return _stem + number + _extension;
+}
+
+void FrameCapture::_WriterLoop() {
+  while (true) {
+    size_t index;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wakeup.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+      if (_jobs.empty()) {
+        // stopped and drained
+        return;
+      }
+      index = _jobs.front();
+      _jobs.pop_front();
+    }
+    // The render thread leaves the readback alone while it is writing.
+    const Readback &readback = _ring[index];
+
+    pxr::HioImage::StorageSpec storage;
+    storage.width = readback.width;
+    storage.height = readback.height;
+    storage.depth = 1;
+    storage.format =
+        _float ? pxr::HioFormatFloat32Vec4 : pxr::HioFormatUNorm8Vec4;
+    // GL rows are bottom-up
+    storage.flipped = true;
+    storage.data = const_cast<void *>(readback.mapped);
+
+    const std::string file = _GetFileName(readback.frame);
+    auto image = pxr::HioImage::OpenForWriting(file);
+    if (!readback.mapped || !image || !image->Write(storage)) {
+      std::cerr << "FrameCapture: cannot write " << file << std::endl;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _ring[index].writing = false;
+    }
+    _written.notify_one();
+  }
+}
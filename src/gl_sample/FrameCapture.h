@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <pxr/imaging/garch/glApi.h>
+#include <string>
+#include <thread>
+
+// Writes the frames drawn by a GLEngineImpl to an image sequence without
+// stalling the render loop.
+//
+// Capture() starts an asynchronous glReadPixels into one of a ring of
+// persistently mapped pixel buffer objects, and hands the one issued
+// ReadbackLatency frames earlier, which the GPU has long finished by then,
+// to a writer thread. The writer encodes straight from the mapping through
+// HioImage, so the render thread copies nothing. It only blocks when the
+// GPU is more than ReadbackLatency frames behind, or when the writer is
+// more than RingSize - ReadbackLatency frames behind; the sequence has no
+// gaps. Needs GL 4.4 buffer storage.
+//
+// "shots/frame.png" writes shots/frame.0000.png, shots/frame.0001.png...
+// The extension picks the format; ".exr" keeps the float color.
+class FrameCapture {
+public:
+  static constexpr size_t RingSize = 5;
+  static constexpr size_t ReadbackLatency = 2;
+
+  explicit FrameCapture(const std::string &path);
+  // Finish() must have been called with the GL context current.
+  ~FrameCapture();
+
+  // Read back the color attachment of framebuffer.
+  void Capture(GLuint framebuffer, int width, int height);
+  // Write out the frames still in flight and release the buffers.
+  void Finish();
+
+  uint64_t GetCapturedCount() const { return _frame; }
+
+private:
+  struct Readback {
+    GLuint buffer = 0;
+    GLsizeiptr size = 0;
+    const void *mapped = nullptr;
+    GLsync fence = nullptr;
+    int width = 0;
+    int height = 0;
+    uint64_t frame = 0;
+    // issued, not handed to the writer yet
+    bool pending = false;
+    // the writer reads mapped; guarded by _mutex
+    bool writing = false;
+  };
+
+  void _Retire(Readback &readback);
+  void _WaitWritten(const Readback &readback);
+  void _WriterLoop();
+  std::string _GetFileName(uint64_t frame) const;
+
+  std::string _stem;
+  std::string _extension;
+  bool _float = false;
+
+  std::array<Readback, RingSize> _ring;
+  size_t _next = 0;
+  uint64_t _frame = 0;
+
+  std::mutex _mutex;
+  std::condition_variable _wakeup;
+  // signaled by the writer when it is done with a readback
+  std::condition_variable _written;
+  // indices into _ring, oldest first
+  std::deque<size_t> _jobs;
+  bool _stop = false;
+  std::thread _writer;
+};
@@ -0,0 +1,59 @@
+#include "FrameTimings.h"
+
+void FrameTimingRing::Record(const FrameTiming &timing) {
+  const uint64_t frame = _recorded.load(std::memory_order_relaxed);
+  Slot &slot = _slots[frame % Capacity];
+  slot.sequence.store(frame * 2 + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timing = timing;
+  slot.timing.frame = frame;
+  slot.sequence.store(frame * 2 + 2, std::memory_order_release);
+  _recorded.store(frame + 1, std::memory_order_release);
+}
+
+std::vector<FrameTiming> FrameTimingRing::Snapshot() const {
+  const uint64_t end = _recorded.load(std::memory_order_acquire);
+  const uint64_t begin = end > Capacity ? end - Capacity : 0;
+
+  std::vector<FrameTiming> timings;
+  timings.reserve(end - begin);
+  for (uint64_t frame = begin; frame < end; ++frame) {
+    const Slot &slot = _slots[frame % Capacity];
+    const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    const FrameTiming timing = slot.timing;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+    // overwritten by a newer frame while copying
+    if (before == after && before == frame * 2 + 2) {
+      timings.push_back(timing);
+    }
+  }
+  return timings;
+}
+
+void FrameTimingRing::WriteCsv(std::ostream &out) const {
+  out << "frame,collection,taskSetup,execute,convergence,iterations,finish,"
+         "capture,blit\n";
+  for (const auto &t : Snapshot()) {
+    out << t.frame << ',' << t.collection << ',' << t.taskSetup << ','
+        << t.execute << ',' << t.convergence << ',' << t.iterations << ','
+        << t.finish << ',' << t.capture << ',' << t.blit << '\n';
+  }
+}
+
+void FrameTimingRing::WriteJson(std::ostream &out) const {
+  out << "[\n";
+  const auto timings = Snapshot();
+  for (size_t i = 0; i < timings.size(); ++i) {
+    const auto &t = timings[i];
+    out << "  {\"frame\": " << t.frame << ", \"collection\": " << t.collection
+        << ", \"taskSetup\": " << t.taskSetup
+        << ", \"execute\": " << t.execute
+        << ", \"convergence\": " << t.convergence
+        << ", \"iterations\": " << t.iterations
+        << ", \"finish\": " << t.finish << ", \"capture\": " << t.capture
+        << ", \"blit\": " << t.blit << "}"
+        << (i + 1 < timings.size() ? ",\n" : "\n");
+  }
+  out << "]\n";
+}
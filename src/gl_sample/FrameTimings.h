@@ -0,0 +1,54 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// CPU time of each phase of one GLEngineImpl::Draw, in milliseconds.
+// Collection, task setup and execute are summed over the convergence
+// iterations of the frame.
+struct FrameTiming {
+  uint64_t frame = 0;
+  // _UpdateHydraCollection and SetCollection
+  double collection = 0.0;
+  // render tags, render params, AOV and color correction settings
+  double taskSetup = 0.0;
+  // HdEngine::Execute, including the render index sync
+  double execute = 0.0;
+  // the whole convergence loop, and how many iterations it ran
+  double convergence = 0.0;
+  int iterations = 0;
+  double finish = 0.0;
+  // queueing the readback when capturing, see FrameCapture
+  double capture = 0.0;
+  double blit = 0.0;
+};
+
+// The timings of the last Capacity frames. One thread (the one drawing)
+// records, any thread can take a snapshot without locking: each slot
+// carries a sequence number that is odd while the slot is being written,
+// and a reader drops the slots it raced with.
+class FrameTimingRing {
+public:
+  static constexpr size_t Capacity = 1024;
+
+  void Record(const FrameTiming &timing);
+  // oldest first
+  std::vector<FrameTiming> Snapshot() const;
+  uint64_t GetRecordedCount() const {
+    return _recorded.load(std::memory_order_acquire);
+  }
+
+  void WriteCsv(std::ostream &out) const;
+  void WriteJson(std::ostream &out) const;
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    FrameTiming timing;
+  };
+  std::array<Slot, Capacity> _slots;
+  std::atomic<uint64_t> _recorded{0};
+};
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <pxr/base/arch/systemInfo.h>
 #include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/half.h>
 #include <pxr/base/gf/matrix4d.h>
 #include <pxr/base/plug/registry.h>
 #include <pxr/base/tf/getenv.h>
@@ -17,6 +18,7 @@
 #include <pxr/imaging/hd/pluginRenderDelegateUniqueHandle.h>
 #include <pxr/imaging/hd/rendererPlugin.h>
 #include <pxr/imaging/hd/rendererPluginRegistry.h>
+#include <pxr/imaging/hdx/renderTask.h>
 #include <pxr/imaging/hdx/taskController.h>
 #include <pxr/imaging/hgi/hgi.h>
 #include <pxr/imaging/hgi/tokens.h>
@@ -32,6 +34,7 @@ class UsdPrim;
 class HdRenderIndex;
 PXR_NAMESPACE_CLOSE_SCOPE
 
+#include <chrono>
 #include <functional>
 
 struct RenderFrameInfo {
@@ -39,8 +42,16 @@ struct RenderFrameInfo {
   std::array<float, 1> clearDepth;
   pxr::GfMatrix4d modelViewMatrix;
   pxr::GfMatrix4d projectionMatrix;
+  pxr::UsdTimeCode time;
 };
 
+// Milliseconds since start.
+static double _ElapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 static void UsdImagingGL_UnitTestHelper_InitPlugins() {
   // Unfortunately, in order to properly find plugins in our test setup, we
   // need to know where the test is running.
@@ -179,16 +190,21 @@ static bool IsColorCorrectionCapable() {
   return false;
 }
 
-GLEngineImpl::GLEngineImpl()
-    : _selTracker(std::make_shared<pxr::HdxSelectionTracker>()) {
-  pxr::GlfRegisterDefaultDebugOutputMessageCallback();
-  pxr::GlfContextCaps::InitInstance();
+GLEngineShared::GLEngineShared(bool headless) : _headless(headless) {
+  if (!headless) {
+    pxr::GlfRegisterDefaultDebugOutputMessageCallback();
+    pxr::GlfContextCaps::InitInstance();
+  }
 
   UsdImagingGL_UnitTestHelper_InitPlugins();
 
-  // _renderIndex, _taskController, and _sceneDelegate are initialized
-  // by the plugin system.
+  // _renderIndex is initialized by the plugin system.
   auto id = _GetDefaultRendererPluginId();
+  if (headless && id.IsEmpty()) {
+    // The default plugin is Storm, which needs GL. Embree renders on the
+    // CPU into render buffers the host can map.
+    id = pxr::TfToken("HdEmbreeRendererPlugin");
+  }
   // if (!SetRendererPlugin(rendererID))
   // {
   // }
@@ -196,12 +212,9 @@ GLEngineImpl::GLEngineImpl()
   {
     using namespace pxr;
     // _InitializeHgiIfNecessary();
-    // If the client of GLEngine does not provide a HdDriver, we
-    // construct a default one that is owned by GLEngine.
-    // The cleanest pattern is for the client app to provide this since you
-    // may have multiple UsdImagingGLEngines in one app that ideally all use
-    // the same HdDriver and Hgi to share GPU resources.
-    if (_hgiDriver.driver.IsEmpty()) {
+    // One HdDriver and Hgi for all the views sharing this render index, so
+    // that they share GPU resources.
+    if (!headless && _hgiDriver.driver.IsEmpty()) {
       _hgi = pxr::Hgi::CreatePlatformDefaultHgi();
       _hgiDriver.name = pxr::HgiTokens->renderDriver;
       _hgiDriver.driver = pxr::VtValue(_hgi.get());
@@ -214,11 +227,6 @@ GLEngineImpl::GLEngineImpl()
     const TfToken resolvedId =
         id.IsEmpty() ? registry.GetDefaultPluginId() : id;
 
-    // if (_renderDelegate && _renderDelegate.GetPluginId() == resolvedId)
-    // {
-    //     return true;
-    // }
-
     TF_PY_ALLOW_THREADS_IN_SCOPE();
 
     HdPluginRenderDelegateUniqueHandle renderDelegate =
@@ -230,60 +238,68 @@ GLEngineImpl::GLEngineImpl()
                       "Check before creation.");
     }
 
-    // _SetRenderDelegate(std::move(renderDelegate));
-    {
-      // This relies on SetRendererPlugin to release the GIL...
+    // Use the new render delegate.
+    _renderDelegate = std::move(renderDelegate);
 
-      // Destruction
-      // _DestroyHydraObjects();
-
-      // _isPopulated = false;
-
-      // Creation
-
-      // Use the new render delegate.
-      _renderDelegate = std::move(renderDelegate);
-
-      // Recreate the render index
-      _renderIndex.reset(
-          pxr::HdRenderIndex::New(_renderDelegate.Get(), {&_hgiDriver}));
+    // Recreate the render index
+    HdDriverVector drivers;
+    if (_hgi) {
+      drivers.push_back(&_hgiDriver);
+    }
+    _renderIndex.reset(
+        pxr::HdRenderIndex::New(_renderDelegate.Get(), drivers));
+  }
+}
 
-      // Create the new task controller
-      _taskController = std::make_unique<pxr::HdxTaskController>(
-          _renderIndex.get(), _ComputeControllerPath(_renderDelegate));
+GLEngineShared::~GLEngineShared() {
+  TF_PY_ALLOW_THREADS_IN_SCOPE();
 
-      // The task context holds on to resources in the render
-      // deletegate, so we want to destroy it first and thus
-      // create it last.
-      _engine = std::make_unique<pxr::HdEngine>();
-    }
+  // Destroy objects in opposite order of construction.
+  _renderIndex = nullptr;
+  _renderDelegate = nullptr;
+}
 
-    // return true;
+GLEngineImpl::GLEngineImpl(std::shared_ptr<GLEngineShared> shared)
+    : _shared(shared ? std::move(shared)
+                     : std::make_shared<GLEngineShared>()),
+      _selTracker(std::make_shared<pxr::HdxSelectionTracker>()) {
+  // Each view has its own task controller, under a path made unique by
+  // this pointer, so views on one render index do not share cameras,
+  // viewports or render buffers.
+  _taskController = std::make_unique<pxr::HdxTaskController>(
+      _shared->RenderIndex(),
+      _ComputeControllerPath(_shared->RenderDelegate()));
+  if (_shared->IsHeadless()) {
+    _taskController->SetEnablePresentation(false);
   }
+
+  // The task context holds on to resources in the render
+  // deletegate, so we want to destroy it first and thus
+  // create it last.
+  _engine = std::make_unique<pxr::HdEngine>();
 }
 
 GLEngineImpl::~GLEngineImpl() {
   TF_PY_ALLOW_THREADS_IN_SCOPE();
 
-  // Destroy objects in opposite order of construction.
+  StopCapture();
+
+  // Destroy objects in opposite order of construction. The render index
+  // goes with the last view holding it.
   _engine = nullptr;
   _taskController = nullptr;
-  _renderIndex = nullptr;
-  _renderDelegate = nullptr;
+  _shared = nullptr;
 }
 
 void GLEngineImpl::Draw(
     // const pxr::UsdStageRefPtr &stage,
     const pxr::SdfPathVector &paths, int width, int height,
-    const pxr::GfMatrix4d &viewMatrix) {
-  const double aspectRatio = double(width) / height;
-  pxr::GfFrustum frustum;
-  frustum.SetPerspective(60.0, aspectRatio, 1, 100000.0);
-
+    const pxr::GfFrustum &frustum, pxr::UsdTimeCode time) {
   RenderFrameInfo frameInfo;
   frameInfo.clearDepth = {1.0f};
   frameInfo.viewport = pxr::GfVec4d(0, 0, width, height);
-  frameInfo.modelViewMatrix = viewMatrix;
+  frameInfo.modelViewMatrix = frustum.ComputeViewMatrix();
+  frameInfo.time = time;
   // if (pxr::UsdGeomGetStageUpAxis(stage) == pxr::UsdGeomTokens->z) {
   //   // rotate from z-up to y-up
   //   frameInfo.modelViewMatrix =
@@ -293,14 +309,45 @@ void GLEngineImpl::Draw(
   // }
   frameInfo.projectionMatrix = frustum.ComputeProjectionMatrix();
 
-  auto fbo = RenderFrame(frameInfo, paths);
+  _frameTiming = FrameTiming();
+  RenderFrame(frameInfo, paths);
+
+  if (_capture && _drawTarget) {
+    const auto captureStart = std::chrono::steady_clock::now();
+    _capture->Capture(_drawTarget->GetFramebufferId(), width, height);
+    _frameTiming.capture = _ElapsedMs(captureStart);
+  }
+
+  const auto blitStart = std::chrono::steady_clock::now();
+  Blit(width, height);
+  _frameTiming.blit = _ElapsedMs(blitStart);
+  _timings.Record(_frameTiming);
+}
+
+void GLEngineImpl::StartCapture(const std::string &path) {
+  StopCapture();
+  _capture = std::make_unique<FrameCapture>(path);
+}
+
+void GLEngineImpl::StopCapture() {
+  if (_capture) {
+    _capture->Finish();
+    _capture = nullptr;
+  }
+}
+
+void GLEngineImpl::Blit(int width, int height) {
+  // headless engines have no draw target
+  if (!_drawTarget) {
+    return;
+  }
 
   //
   // Blit the resulting color buffer to the window (this is a noop
   // if we're drawing offscreen).
   //
   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-  glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, _drawTarget->GetFramebufferId());
 
   glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
                     GL_COLOR_BUFFER_BIT, GL_NEAREST);
@@ -311,6 +358,13 @@ void GLEngineImpl::Draw(
 
 uint32_t GLEngineImpl::RenderFrame(const RenderFrameInfo &info,
                                    const pxr::SdfPathVector &paths) {
+  auto width = info.viewport.data()[2];
+  auto height = info.viewport.data()[3];
+
+  if (_shared->IsHeadless()) {
+    return _RenderFrameHeadless(info, paths);
+  }
+
   static bool s_glInitilazed = false;
   if (!s_glInitilazed) {
     if (!_InitGL()) {
@@ -320,9 +374,6 @@ uint32_t GLEngineImpl::RenderFrame(const RenderFrameInfo &info,
     s_glInitilazed = true;
   }
 
-  auto width = info.viewport.data()[2];
-  auto height = info.viewport.data()[3];
-
   if (!_drawTarget) {
     //
     // Create an offscreen draw target which is the same size as this
@@ -345,31 +396,129 @@ uint32_t GLEngineImpl::RenderFrame(const RenderFrameInfo &info,
   glViewport(0, 0, width, height);
   glEnable(GL_DEPTH_TEST);
 
+  const pxr::UsdImagingGLRenderParams params = _MakeRenderParams(info);
+  _Converge(params, paths, [&params, &info]() {
+    glClearBufferfv(GL_COLOR, 0, params.clearColor.data());
+    glClearBufferfv(GL_DEPTH, 0, info.clearDepth.data());
+  });
+
+  if (_convergenceBudgetMs <= 0.0) {
+    // When time-sliced, the blit that follows is ordered after the
+    // rendering anyway; waiting here would only stall the UI.
+    TRACE_FUNCTION_SCOPE("glFinish");
+    const auto finishStart = std::chrono::steady_clock::now();
+    glFinish();
+    _frameTiming.finish = _ElapsedMs(finishStart);
+  }
+
+  _drawTarget->Unbind();
+
+  return _drawTarget->GetFramebufferId();
+}
+
+pxr::UsdImagingGLRenderParams
+GLEngineImpl::_MakeRenderParams(const RenderFrameInfo &info) {
   pxr::UsdImagingGLRenderParams params;
   params.drawMode = pxr::UsdImagingGLDrawMode::DRAW_SHADED_SMOOTH;
   params.enableLighting = false;
   params.clearColor = pxr::GfVec4f(1.0f, 0.5f, 0.1f, 1.0f);
-  params.frame = pxr::UsdTimeCode::Default();
+  params.frame = info.time;
+  return params;
+}
+
+// No GL: the render delegate draws into its own render buffers, which the
+// task controller creates for the color and depth AOVs. The frame is read
+// back with ReadColor.
+uint32_t GLEngineImpl::_RenderFrameHeadless(const RenderFrameInfo &info,
+                                            const pxr::SdfPathVector &paths) {
+  const int width = int(info.viewport[2]);
+  const int height = int(info.viewport[3]);
+  _taskController->SetRenderBufferSize(pxr::GfVec2i(width, height));
+  SetRenderViewport(info.viewport);
+  SetCameraState(info.modelViewMatrix, info.projectionMatrix);
+
+  // the color AOV clears itself to params.clearColor
+  _Converge(_MakeRenderParams(info), paths, nullptr);
+  return 0;
+}
+
+// Renders convergence iterations until the image has converged or, when
+// time-sliced, the budget is spent. clear, if set, runs before each
+// iteration.
+void GLEngineImpl::_Converge(const pxr::UsdImagingGLRenderParams &params,
+                             const pxr::SdfPathVector &paths,
+                             const std::function<void()> &clear) {
+  const bool timeSliced = _convergenceBudgetMs > 0.0;
+  const auto convergenceStart = std::chrono::steady_clock::now();
   for (int convergenceIterations = 0; true; convergenceIterations++) {
     TRACE_FUNCTION_SCOPE("iteration render convergence");
-
-    glClearBufferfv(GL_COLOR, 0, params.clearColor.data());
-    glClearBufferfv(GL_DEPTH, 0, info.clearDepth.data());
+    _frameTiming.iterations = convergenceIterations + 1;
+    if (clear) {
+      clear();
+    }
 
     Render(params, paths);
     if (IsConverged()) {
       break;
     }
-  }
 
-  {
-    TRACE_FUNCTION_SCOPE("glFinish");
-    glFinish();
+    if (timeSliced && _ElapsedMs(convergenceStart) >= _convergenceBudgetMs) {
+      // Out of time: show the partial image and continue on the next
+      // paint.
+      break;
+    }
   }
+  _frameTiming.convergence = _ElapsedMs(convergenceStart);
+}
 
-  _drawTarget->Unbind();
-
-  return _drawTarget->GetFramebufferId();
+bool GLEngineImpl::ReadColor(int *width, int *height,
+                             std::vector<float> *rgba) {
+  using namespace pxr;
+  HdRenderBuffer *buffer =
+      _taskController->GetRenderOutput(HdAovTokens->color);
+  if (!buffer) {
+    return false;
+  }
+  buffer->Resolve();
+
+  *width = int(buffer->GetWidth());
+  *height = int(buffer->GetHeight());
+  const size_t pixelCount = size_t(*width) * *height;
+  rgba->resize(pixelCount * 4);
+
+  const HdFormat format = buffer->GetFormat();
+  const size_t components = HdGetComponentCount(format);
+  const HdFormat componentFormat = HdGetComponentFormat(format);
+  const void *data = buffer->Map();
+  if (!data) {
+    return false;
+  }
+  bool converted = true;
+  for (size_t i = 0; i < pixelCount; ++i) {
+    for (size_t c = 0; c < 4; ++c) {
+      float value = c == 3 ? 1.0f : 0.0f;
+      if (c < components) {
+        const size_t index = i * components + c;
+        switch (componentFormat) {
+        case HdFormatFloat32:
+          value = static_cast<const float *>(data)[index];
+          break;
+        case HdFormatFloat16:
+          value = static_cast<const GfHalf *>(data)[index];
+          break;
+        case HdFormatUNorm8:
+          value = static_cast<const uint8_t *>(data)[index] / 255.0f;
+          break;
+        default:
+          converted = false;
+          break;
+        }
+      }
+      (*rgba)[i * 4 + c] = value;
+    }
+  }
+  buffer->Unmap();
+  return converted;
 }
 
 void GLEngineImpl::Render(const pxr::UsdImagingGLRenderParams &params,
@@ -384,10 +533,13 @@ void GLEngineImpl::Render(const pxr::UsdImagingGLRenderParams &params,
 
     TF_VERIFY(_taskController);
 
+    auto phaseStart = std::chrono::steady_clock::now();
     _taskController->SetFreeCameraClipPlanes(params.clipPlanes);
     _UpdateHydraCollection(&_renderCollection, paths, params);
     _taskController->SetCollection(_renderCollection);
+    _frameTiming.collection += _ElapsedMs(phaseStart);
 
+    phaseStart = std::chrono::steady_clock::now();
     pxr::TfTokenVector renderTags;
     _ComputeRenderTags(params, &renderTags);
     _taskController->SetRenderTags(renderTags);
@@ -412,6 +564,8 @@ void GLEngineImpl::Render(const pxr::UsdImagingGLRenderParams &params,
 
     VtValue selectionValue(_selTracker);
     _engine->SetTaskContextData(HdxTokens->selectionState, selectionValue);
+    _frameTiming.taskSetup += _ElapsedMs(phaseStart);
+
     _Execute(params, _taskController->GetRenderingTasks());
   }
 }
@@ -536,6 +690,21 @@ void GLEngineImpl::_Execute(const pxr::UsdImagingGLRenderParams &params,
                             pxr::HdTaskSharedPtrVector tasks) {
   using namespace pxr;
 
+  if (_shared->IsHeadless()) {
+    // Only the render tasks: the AOV input, color correction and present
+    // tasks move the render buffers through Hgi, which we do not have.
+    HdTaskSharedPtrVector renderTasks;
+    for (const auto &task : tasks) {
+      if (std::dynamic_pointer_cast<HdxRenderTask>(task)) {
+        renderTasks.push_back(task);
+      }
+    }
+    const auto executeStart = std::chrono::steady_clock::now();
+    _engine->Execute(_shared->RenderIndex(), &renderTasks);
+    _frameTiming.execute += _ElapsedMs(executeStart);
+    return;
+  }
+
   // User is responsible for initializing GL context and glew
   const bool isCoreProfileContext = GlfContextCaps::GetInstance().coreProfile;
 
@@ -588,7 +757,9 @@ void GLEngineImpl::_Execute(const pxr::UsdImagingGLRenderParams &params,
     // Release the GIL before calling into hydra, in case any hydra plugins
     // call into python.
     TF_PY_ALLOW_THREADS_IN_SCOPE();
-    _engine->Execute(_renderIndex.get(), &tasks);
+    const auto executeStart = std::chrono::steady_clock::now();
+    _engine->Execute(_shared->RenderIndex(), &tasks);
+    _frameTiming.execute += _ElapsedMs(executeStart);
   }
 
   if (isCoreProfileContext) {
@@ -1,9 +1,15 @@
 #pragma once
+#include "FrameCapture.h"
+#include "FrameTimings.h"
+#include "pxr/base/gf/frustum.h"
 #include "pxr/base/gf/matrix4d.h"
 #include "pxr/usd/sdf/path.h"
 #include "pxr/usd/usd/stage.h"
 #include <cstddef>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <vector>
 #include <pxr/base/arch/systemInfo.h>
 #include <pxr/base/plug/registry.h>
 #include <pxr/base/tf/getenv.h>
@@ -25,35 +31,110 @@
 #include <pxr/usd/usdGeom/tokens.h>
 #include <pxr/usdImaging/usdImagingGL/renderParams.h>
 
-class GLEngineImpl {
+// The Hgi, its HdDriver, the render delegate and the render index. Views
+// that show the same scene share one, so the scene is synced and stored on
+// the GPU once however many views draw it.
+//
+// A headless one has no Hgi and renders with a CPU render delegate
+// (HD_DEFAULT_RENDERER, or HdEmbree) into render buffers, without a GL
+// context.
+class GLEngineShared {
+  bool _headless = false;
   pxr::HgiUniquePtr _hgi;
   pxr::HdDriver _hgiDriver;
-
-  std::unique_ptr<pxr::HdxTaskController> _taskController;
   pxr::HdPluginRenderDelegateUniqueHandle _renderDelegate;
   std::unique_ptr<pxr::HdRenderIndex> _renderIndex;
+
+public:
+  explicit GLEngineShared(bool headless = false);
+  ~GLEngineShared();
+  bool IsHeadless() const { return _headless; }
+  pxr::HdRenderIndex *RenderIndex() { return _renderIndex.get(); }
+  const pxr::HdPluginRenderDelegateUniqueHandle &RenderDelegate() const {
+    return _renderDelegate;
+  }
+};
+
+// One view: a task controller, a camera and a draw target on top of a
+// shared render index.
+class GLEngineImpl {
+  std::shared_ptr<GLEngineShared> _shared;
+
+  std::unique_ptr<pxr::HdxTaskController> _taskController;
   std::unique_ptr<pxr::HdEngine> _engine;
   pxr::HdxSelectionTrackerSharedPtr _selTracker;
   pxr::GfVec4f _selectionColor = {1.0f, 1.0f, 0.0f, 1.0f};
   pxr::HdRprimCollection _renderCollection;
   pxr::GlfDrawTargetRefPtr _drawTarget;
+  // 0: iterate until converged within one frame
+  double _convergenceBudgetMs = 0.0;
+  // phases of the frame being drawn, recorded into _timings by Draw
+  FrameTiming _frameTiming;
+  FrameTimingRing _timings;
+  std::unique_ptr<FrameCapture> _capture;
 
 public:
-  GLEngineImpl();
+  // Without a shared render index the engine creates its own.
+  explicit GLEngineImpl(std::shared_ptr<GLEngineShared> shared = nullptr);
   ~GLEngineImpl();
-  pxr::HdRenderIndex *RenderIndex() { return _renderIndex.get(); }
+  pxr::HdRenderIndex *RenderIndex() { return _shared->RenderIndex(); }
+  const std::shared_ptr<GLEngineShared> &Shared() const { return _shared; }
+
+  // Renderer-specific statistics of the last frame, if the render delegate
+  // reports any (see HdRenderDelegate::GetRenderStats).
+  pxr::VtDictionary GetRenderStats() const {
+    const auto &renderDelegate = _shared->RenderDelegate();
+    return renderDelegate ? renderDelegate->GetRenderStats()
+                          : pxr::VtDictionary();
+  }
 
   void Draw(
       // const pxr::UsdStageRefPtr &stage,
       const pxr::SdfPathVector &paths, int width, int height,
-      const pxr::GfMatrix4d &viewMatrix);
+      const pxr::GfFrustum &frustum,
+      pxr::UsdTimeCode time = pxr::UsdTimeCode::Default());
+
+  // Copy the last rendered frame to the window without rendering. Does
+  // nothing when headless.
+  void Blit(int width, int height);
+
+  // The color AOV of the last frame as float RGBA, bottom row first.
+  // For headless engines, whose frames never reach a window.
+  bool ReadColor(int *width, int *height, std::vector<float> *rgba);
+
+  bool IsConverged();
+
+  // Write every drawn frame to an image sequence, see FrameCapture. Both
+  // need the GL context current.
+  void StartCapture(const std::string &path);
+  void StopCapture();
+  bool IsCapturing() const { return bool(_capture); }
+
+  // Per-phase CPU timings of the last FrameTimingRing::Capacity Draw
+  // calls. Safe to read from another thread.
+  const FrameTimingRing &FrameTimings() const { return _timings; }
+
+  // Time-sliced convergence: RenderFrame runs as many convergence
+  // iterations as fit in this many milliseconds and returns the partial
+  // image. Progressive renderers keep their state, so the next call
+  // resumes where this one stopped while IsConverged() is false.
+  // 0 renders until converged, blocking the caller.
+  void SetConvergenceBudget(double milliseconds) {
+    _convergenceBudgetMs = milliseconds;
+  }
 
 private:
   uint32_t RenderFrame(const struct RenderFrameInfo &info,
                        const pxr::SdfPathVector &paths);
+  uint32_t _RenderFrameHeadless(const struct RenderFrameInfo &info,
+                                const pxr::SdfPathVector &paths);
+  pxr::UsdImagingGLRenderParams
+  _MakeRenderParams(const struct RenderFrameInfo &info);
+  void _Converge(const pxr::UsdImagingGLRenderParams &params,
+                 const pxr::SdfPathVector &paths,
+                 const std::function<void()> &clear);
   void Render(const pxr::UsdImagingGLRenderParams &params,
               const pxr::SdfPathVector &paths);
-  bool IsConverged();
 
   void SetCameraState(const pxr::GfMatrix4d &viewMatrix,
                       const pxr::GfMatrix4d &projectionMatrix);
@@ -1,5 +1,30 @@
 #include "HDHost.h"
 #include "GLEngine.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <pxr/base/tf/getenv.h>
+#include <pxr/base/tf/stopwatch.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/work/detachedTask.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/types.h>
+#include <pxr/usd/usd/attributeQuery.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/schemaRegistry.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <pxr/usd/usdGeom/gprim.h>
+#include <pxr/usd/usdGeom/imageable.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/pointInstancer.h>
+#include <pxr/usd/usdGeom/tokens.h>
 
 static int _GetRefineLevel(float c) {
   // TODO: Change complexity to refineLevel when we refactor UsdImaging.
@@ -35,35 +60,365 @@ static int _GetRefineLevel(float c) {
   return refineLevel;
 }
 
-HDHost::HDHost() {}
+HDHost::HDHost() : _views(1) {}
 
 HDHost::~HDHost() { Shutdown(); }
 
 void HDHost::Shutdown() {
+  Stop();
+  _CancelPrefetch();
+  pxr::TfNotice::Revoke(_objectsChangedKey);
+  if (_opening.valid()) {
+    _opening.wait();
+    _opening = {};
+  }
+  _pendingPayloads.clear();
+  _loadedPayloads.clear();
+  _cullCandidates.clear();
+  _newCullCandidates.clear();
+  _invisedPrimPaths.clear();
+  _refineLevels.clear();
+  _cullStates.clear();
+  _hasCulled = false;
+  _hasBounds = false;
+  _stageBounds = pxr::GfRange3d();
+  _DumpFrameTimings();
+  // The delegate removes its prims from the render index, which goes
+  // away with the last view.
   if (_sceneDelegate) {
     delete _sceneDelegate;
     _sceneDelegate = nullptr;
   }
-  if (_engine) {
-    delete _engine;
-    _engine = nullptr;
+  for (auto &view : _views) {
+    view.hasDrawn = false;
+    view.engine.reset();
+  }
+  _shared = nullptr;
+}
+
+void HDHost::Load(const char *path) {
+  pxr::TfNotice::Revoke(_objectsChangedKey);
+  _CancelPrefetch();
+  _stage = nullptr;
+  _pendingPayloads.clear();
+  _loadedPayloads.clear();
+  _hasBounds = false;
+  _stageBounds = pxr::GfRange3d();
+  for (size_t view = 0; view < _views.size(); ++view) {
+    _framePending.push_back(view);
+  }
+  // Composing without payloads is fast even on large sets; the payloads
+  // are loaded a few per frame by _LoadPayloads.
+  std::string file(path);
+  _opening = std::async(std::launch::async, [file, mask = _populationMask]() {
+    if (mask.IsEmpty()) {
+      return pxr::UsdStage::Open(file, pxr::UsdStage::LoadNone);
+    }
+    return pxr::UsdStage::OpenMasked(file, mask, pxr::UsdStage::LoadNone);
+  });
+  ++_sceneVersion;
+  ++_resyncVersion;
+}
+
+bool HDHost::_FinishOpen() {
+  if (_stage) {
+    return true;
+  }
+  if (!_opening.valid() || _opening.wait_for(std::chrono::seconds(0)) !=
+                               std::future_status::ready) {
+    return false;
+  }
+  _stage = _opening.get();
+  if (!_stage) {
+    return false;
+  }
+  _excludedPrimPaths.clear();
+  SessionEdits edits;
+  _QueuePayloads(_stage->GetPseudoRoot(), &_excludedPrimPaths,
+                 &edits.addProxies);
+  _ApplySessionEdits(edits);
+  _objectsChangedKey = pxr::TfNotice::Register(
+      pxr::TfCreateWeakPtr(this), &HDHost::_OnObjectsChanged, _stage);
+  return true;
+}
+
+bool HDHost::_IsExcluded(const pxr::UsdPrim &prim) const {
+  for (const auto &type : _excludedTypes) {
+    if (prim.IsA(type)) {
+      return true;
+    }
+  }
+  if (!_excludedPurposes.empty()) {
+    // Only authored purposes: children inherit them, and the traversal
+    // prunes below an excluded prim. The unauthored fallback "default"
+    // never matches.
+    const pxr::UsdAttribute attr = pxr::UsdGeomImageable(prim).GetPurposeAttr();
+    pxr::TfToken purpose;
+    if (attr.HasAuthoredValue() && attr.Get(&purpose) &&
+        std::find(_excludedPurposes.begin(), _excludedPurposes.end(),
+                  purpose) != _excludedPurposes.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Only collects: authoring while the range is being walked would
+// recompose the stage under the iterator. The bounds proxies of the queued
+// payloads are returned in proxies.
+void HDHost::_QueuePayloads(const pxr::UsdPrim &root,
+                            pxr::SdfPathVector *excluded,
+                            pxr::SdfPathVector *proxies) {
+  // the default predicate skips unloaded prims
+  auto range = pxr::UsdPrimRange(
+      root, pxr::UsdPrimIsActive && pxr::UsdPrimIsDefined &&
+                !pxr::UsdPrimIsAbstract);
+  for (auto it = range.begin(); it != range.end(); ++it) {
+    if (_IsExcluded(*it)) {
+      // neither synced nor loaded
+      it.PruneChildren();
+      excluded->push_back(it->GetPath());
+      continue;
+    }
+    if (!it->HasAuthoredPayloads() || it->IsLoaded()) {
+      continue;
+    }
+    // nothing below an unloaded payload is composed yet
+    it.PruneChildren();
+
+    Payload payload;
+    payload.path = it->GetPath();
+    // the same bounds as framing and culling
+    auto bounds = _bboxCache.ComputeWorldBound(*it).ComputeAlignedRange();
+    if (!bounds.IsEmpty()) {
+      payload.center = bounds.GetMidpoint();
+      payload.hasBounds = true;
+      proxies->push_back(payload.path);
+    }
+    _pendingPayloads.push_back(payload);
+  }
+}
+
+// Unloaded payloads are drawn as their extentsHint box until they are
+// loaded. All opinions live on the session layer so the stage's own layers
+// are left untouched. They are written through Sdf in one change block, so
+// the stage recomposes once for the whole batch instead of once per prim.
+void HDHost::_ApplySessionEdits(const SessionEdits &edits) {
+  if (edits.addProxies.empty() && edits.removeProxies.empty() &&
+      edits.deactivate.empty()) {
+    return;
+  }
+  const pxr::SdfLayerHandle layer = _stage->GetSessionLayer();
+  pxr::SdfChangeBlock block;
+  for (const auto &path : edits.removeProxies) {
+    auto prim = layer->GetPrimAtPath(path);
+    if (!prim) {
+      continue;
+    }
+    for (const auto &name : {pxr::UsdGeomTokens->modelDrawMode,
+                             pxr::UsdGeomTokens->modelApplyDrawMode}) {
+      if (auto attr = layer->GetAttributeAtPath(path.AppendProperty(name))) {
+        prim->RemoveProperty(attr);
+      }
+    }
+  }
+  for (const auto &path : edits.addProxies) {
+    auto prim = pxr::SdfCreatePrimInLayer(layer, path);
+    auto drawMode = pxr::SdfAttributeSpec::New(
+        prim, pxr::UsdGeomTokens->modelDrawMode,
+        pxr::SdfValueTypeNames->Token, pxr::SdfVariabilityUniform);
+    drawMode->SetDefaultValue(pxr::VtValue(pxr::UsdGeomTokens->bounds));
+    auto applyDrawMode = pxr::SdfAttributeSpec::New(
+        prim, pxr::UsdGeomTokens->modelApplyDrawMode,
+        pxr::SdfValueTypeNames->Bool, pxr::SdfVariabilityUniform);
+    applyDrawMode->SetDefaultValue(pxr::VtValue(true));
+  }
+  for (const auto &path : edits.deactivate) {
+    pxr::SdfCreatePrimInLayer(layer, path)->SetActive(false);
+  }
+}
+
+void HDHost::_LoadPayloads() {
+  if (_pendingPayloads.empty()) {
+    return;
+  }
+
+  // Sort farthest first, so the nearest payload is popped from the back.
+  const pxr::GfVec3d eye =
+      _views[0].camera.ViewMatrix().GetInverse().ExtractTranslation();
+  auto distance = [&eye](const Payload &payload) {
+    return payload.hasBounds ? (payload.center - eye).GetLengthSq()
+                             : std::numeric_limits<double>::max();
+  };
+  std::sort(_pendingPayloads.begin(), _pendingPayloads.end(),
+            [&distance](const Payload &lhs, const Payload &rhs) {
+              return distance(lhs) > distance(rhs);
+            });
+
+  pxr::TfStopwatch timer;
+  SessionEdits edits;
+  _loadingPayloads = true;
+  while (!_pendingPayloads.empty()) {
+    timer.Start();
+    Payload payload = _pendingPayloads.back();
+    _pendingPayloads.pop_back();
+    if (_stage->GetPrimAtPath(payload.path)) {
+      if (payload.hasBounds) {
+        edits.removeProxies.push_back(payload.path);
+      }
+      _stage->Load(payload.path, pxr::UsdLoadWithoutDescendants);
+      _loadedPayloads.push_back(payload.path);
+      // Payloads nested in the one just composed. The delegate's excluded
+      // paths are fixed at Populate, so the filtered prims in the payload
+      // are deactivated instead.
+      _QueuePayloads(_stage->GetPrimAtPath(payload.path), &edits.deactivate,
+                     &edits.addProxies);
+    }
+    timer.Stop();
+    if (timer.GetMilliseconds() >= _payloadBudgetMs) {
+      break;
+    }
+  }
+  // before the delegate applies this frame's updates
+  _ApplySessionEdits(edits);
+  _loadingPayloads = false;
+}
+
+void HDHost::_OnObjectsChanged(const pxr::UsdNotice::ObjectsChanged &notice,
+                               const pxr::UsdStageWeakPtr &sender) {
+  ++_sceneVersion;
+  if (_loadingPayloads) {
+    // our own loads and session layer edits, see _UpdateBounds
+    return;
+  }
+  if (!notice.GetResyncedPaths().empty()) {
+    ++_resyncVersion;
+    ++_boundsVersion;
+    return;
+  }
+  for (const auto &path : notice.GetChangedInfoOnlyPaths()) {
+    if (_AffectsBounds(path)) {
+      ++_boundsVersion;
+      return;
+    }
+  }
+}
+
+// Conservative: anything but the property namespaces that never feed
+// geometry (shading, primvars, draw modes) may move a bound. This keeps the
+// bounds proxies of unloaded payloads from clearing the cache.
+bool HDHost::_AffectsBounds(const pxr::SdfPath &changedPath) {
+  if (!changedPath.IsPropertyPath()) {
+    return true;
+  }
+  static const char *const unrelated[] = {"primvars:", "material:", "model:",
+                                          "inputs:",   "outputs:", "info:"};
+  const std::string &name = changedPath.GetName();
+  for (const char *prefix : unrelated) {
+    if (pxr::TfStringStartsWith(name, prefix)) {
+      return false;
+    }
   }
+  return true;
 }
 
-void HDHost::Load(const char *path) { _stage = pxr::UsdStage::Open(path); }
+void HDHost::_UpdateBounds() {
+  if (_hasIncrementalBounds &&
+      (_boundsTime != _time || _pendingPayloads.empty())) {
+    // The cache entries of the loaded payload prims and their ancestors
+    // still describe them unloaded, and the root query would read them.
+    // Recompute once when the time moves during loading, and once after
+    // the last payload.
+    ++_boundsVersion;
+  }
+  const bool cleared = !_hasBounds || _cachedBoundsVersion != _boundsVersion;
+  if (cleared || _boundsTime != _time) {
+    if (cleared) {
+      _bboxCache.Clear();
+      _hasIncrementalBounds = false;
+    }
+    _bboxCache.SetTime(_time);
+    // One query from the root fills the cache for the whole stage, in
+    // parallel; per-prim queries are lookups after that.
+    _stageBounds =
+        _bboxCache.ComputeWorldBound(_stage->GetPseudoRoot())
+            .ComputeAlignedRange();
+    _cachedBoundsVersion = _boundsVersion;
+    _boundsTime = _time;
+    _hasBounds = true;
+    ++_boundsGeneration;
+  }
 
-void HDHost::Draw(int width, int height) {
-  if (!_engine) {
-    _engine = new GLEngineImpl();
+  // Only the subtrees composed by this frame's loads: their prims are new
+  // to the cache. The payload prim itself was a candidate already.
+  for (const auto &path : _loadedPayloads) {
+    const pxr::UsdPrim prim = _stage->GetPrimAtPath(path);
+    if (!prim) {
+      continue;
+    }
+    const size_t first = _newCullCandidates.size();
+    for (const auto &child : prim.GetChildren()) {
+      _AppendCullCandidates(child, &_newCullCandidates);
+    }
+    for (size_t i = first; i < _newCullCandidates.size(); ++i) {
+      auto &candidate = _newCullCandidates[i];
+      candidate.bounds = _bboxCache.ComputeWorldBound(candidate.prim);
+      _stageBounds.UnionWith(candidate.bounds.ComputeAlignedRange());
+    }
+    _hasIncrementalBounds = _hasIncrementalBounds || !cleared;
+  }
+  _loadedPayloads.clear();
+}
+
+void HDHost::Frame(size_t view) {
+  _framePending.push_back(view);
+}
+
+bool HDHost::Draw(int width, int height) {
+  _views[0].width = width;
+  _views[0].height = height;
+  Update();
+  return Draw(0, width, height);
+}
+
+size_t HDHost::AddView() {
+  _views.emplace_back();
+  _framePending.push_back(_views.size() - 1);
+  return _views.size() - 1;
+}
+
+HDHost::DrawState HDHost::_GetDrawState(const View &view) const {
+  DrawState state;
+  state.camera = view.camera.Version();
+  state.scene = _sceneVersion;
+  state.time = _time;
+  state.width = view.width;
+  state.height = view.height;
+  return state;
+}
+
+void HDHost::Update() {
+  if (!_FinishOpen()) {
+    // still composing
+    return;
+  }
+  if (_playing) {
+    _AdvancePlayback();
+  }
+
+  if (_sceneDelegate) {
+    // The stage notices from these loads bump _sceneVersion, and the
+    // UsdImagingDelegate resyncs the new prims in ApplyPendingUpdates.
+    _LoadPayloads();
+  } else {
+    _shared = std::make_shared<GLEngineShared>(_headless);
     _sceneDelegate = new pxr::UsdImagingDelegate(
-        _engine->RenderIndex(), pxr::SdfPath::AbsoluteRootPath());
-    // _sceneDelegate->SetUsdDrawModesEnabled(params.enableUsdDrawModes);
-    pxr::SdfPathVector _excludedPrimPaths;
+        _shared->RenderIndex(), pxr::SdfPath::AbsoluteRootPath());
+    // unloaded payloads are drawn as bounds proxies
+    _sceneDelegate->SetUsdDrawModesEnabled(true);
     _sceneDelegate->Populate(
         _stage->GetPrimAtPath(_stage->GetPseudoRoot().GetPath()),
         _excludedPrimPaths);
-    pxr::SdfPathVector _invisedPrimPaths;
-    _sceneDelegate->SetInvisedPrimPaths(_invisedPrimPaths);
   }
 
   // Set the fallback refine level, if this changes from the existing
@@ -71,26 +426,504 @@ void HDHost::Draw(int width, int height) {
   const int refineLevel = _GetRefineLevel(/*params.complexity*/ 1.0f);
   _sceneDelegate->SetRefineLevelFallback(refineLevel);
 
+  // Dirties only the time-varying prims, and only if the time changed.
+  _sceneDelegate->SetTime(_time);
+
   // Apply any queued up scene edits.
   _sceneDelegate->ApplyPendingUpdates();
 
+  _UpdateBounds();
+  if (!_stageBounds.IsEmpty()) {
+    for (size_t view : _framePending) {
+      if (view < _views.size()) {
+        _views[view].camera.Frame(_stageBounds);
+      }
+    }
+    _framePending.clear();
+  }
+
+  _UpdateCulling();
+
+  if (_playing) {
+    _PrefetchAhead();
+  }
+}
+
+bool HDHost::Draw(size_t index, int width, int height) {
+  if (!_sceneDelegate || index >= _views.size()) {
+    return false;
+  }
+  View &view = _views[index];
+  view.width = width;
+  view.height = height;
+
+  const DrawState state = _GetDrawState(view);
+  if (view.hasDrawn && state == view.lastDraw && view.engine->IsConverged()) {
+    // Nothing changed since the last frame.
+    view.engine->Blit(width, height);
+    return false;
+  }
+  view.lastDraw = state;
+  view.hasDrawn = true;
+
+  if (!view.engine) {
+    view.engine = std::make_unique<GLEngineImpl>(_shared);
+    view.engine->SetConvergenceBudget(_convergenceBudgetMs);
+    if (!view.capturePath.empty()) {
+      view.engine->StartCapture(view.capturePath);
+    }
+  }
+
   // XXX(UsdImagingPaths): Is it correct to map USD root path directly
   // to the cachePath here?
   // const SdfPath cachePath = root.GetPath();
   auto paths = {_sceneDelegate->ConvertCachePathToIndexPath(
       _stage->GetPseudoRoot().GetPath())};
 
-  _engine->Draw(paths, width, height, _camera.ViewMatrix());
+  // The first view to execute syncs the render index, the others find
+  // nothing dirty.
+  view.engine->Draw(paths, width, height, view.Frustum(_stageBounds), _time);
+  return true;
+}
+
+void HDHost::SetCulling(bool enable) {
+  _culling = enable;
+  _hasCulled = false;
+  ++_sceneVersion;
+}
+
+void HDHost::_AppendCullCandidates(const pxr::UsdPrim &root,
+                                   std::vector<CullCandidate> *candidates) {
+  auto range = pxr::UsdPrimRange(root);
+  for (auto it = range.begin(); it != range.end(); ++it) {
+    if (it->IsA<pxr::UsdGeomGprim>() ||
+        it->IsA<pxr::UsdGeomPointInstancer>() || it->IsInstance()) {
+      // prototypes below an instancer go with it
+      it.PruneChildren();
+      candidates->push_back({*it, pxr::GfBBox3d()});
+    }
+  }
+}
+
+void HDHost::_UpdateCulling() {
+  if (!_culling && !_autoRefine) {
+    // rebuilt in full once culling is back on
+    _newCullCandidates.clear();
+    if (!_invisedPrimPaths.empty()) {
+      _invisedPrimPaths.clear();
+      _sceneDelegate->SetInvisedPrimPaths(_invisedPrimPaths);
+    }
+    return;
+  }
+
+  std::vector<DrawState> states;
+  std::vector<pxr::GfFrustum> frusta;
+  for (const auto &view : _views) {
+    states.push_back(_GetDrawState(view));
+    // A view that has not been drawn yet has no size; it is culled for
+    // from the frame after its first Draw.
+    if (view.height > 0) {
+      frusta.push_back(view.Frustum(_stageBounds));
+    }
+  }
+  if (_hasCulled && states == _cullStates &&
+      _culledBoundsGeneration == _boundsGeneration &&
+      _newCullCandidates.empty()) {
+    return;
+  }
+
+  // Payload loads only add candidates; anything else that resyncs the
+  // stage takes a full traversal.
+  const bool sceneChanged =
+      !_hasCulled || _culledResyncVersion != _resyncVersion;
+  if (sceneChanged) {
+    _cullCandidates.clear();
+    _AppendCullCandidates(_stage->GetPseudoRoot(), &_cullCandidates);
+    _culledResyncVersion = _resyncVersion;
+  } else {
+    // their bounds were looked up by _UpdateBounds
+    _cullCandidates.insert(_cullCandidates.end(), _newCullCandidates.begin(),
+                           _newCullCandidates.end());
+  }
+  _newCullCandidates.clear();
+  if (sceneChanged || _culledBoundsGeneration != _boundsGeneration) {
+    // lookups in the cache _UpdateBounds filled
+    for (auto &candidate : _cullCandidates) {
+      candidate.bounds = _bboxCache.ComputeWorldBound(candidate.prim);
+    }
+  }
+  _cullStates.swap(states);
+  _culledBoundsGeneration = _boundsGeneration;
+  _hasCulled = true;
+
+  const bool cull = _culling && !frusta.empty();
+  std::vector<char> visible(_cullCandidates.size());
+  pxr::WorkParallelForN(
+      _cullCandidates.size(), [&](size_t begin, size_t end) {
+        // GfFrustum computes its planes lazily; use copies per task
+        const std::vector<pxr::GfFrustum> local = frusta;
+        for (size_t i = begin; i < end; ++i) {
+          const auto &bounds = _cullCandidates[i].bounds;
+          visible[i] = !cull || bounds.GetRange().IsEmpty() ||
+                       std::any_of(local.begin(), local.end(),
+                                   [&bounds](const pxr::GfFrustum &frustum) {
+                                     return frustum.Intersects(bounds);
+                                   });
+        }
+      });
+
+  pxr::SdfPathVector invised;
+  for (size_t i = 0; i < _cullCandidates.size(); ++i) {
+    if (!visible[i]) {
+      invised.push_back(_cullCandidates[i].prim.GetPath());
+    }
+  }
+  if (invised != _invisedPrimPaths) {
+    // The delegate dirties only the prims whose state changed.
+    _invisedPrimPaths.swap(invised);
+    _sceneDelegate->SetInvisedPrimPaths(_invisedPrimPaths);
+  }
+
+  if (_autoRefine) {
+    _UpdateRefineLevels(visible);
+  }
+}
+
+void HDHost::SetAutoRefine(bool enable, int maxRefineLevel) {
+  _autoRefine = enable;
+  _maxRefineLevel = std::min(std::max(maxRefineLevel, 0), 8);
+  if (!enable && _sceneDelegate) {
+    // back to the fallback level
+    for (auto &entry : _refineLevels) {
+      _sceneDelegate->ClearRefineLevel(entry.first);
+    }
+  }
+  _refineLevels.clear();
+  _hasCulled = false;
+  ++_sceneVersion;
+}
+
+// Each refine level halves the edge length of a subdivision surface, so
+// the level follows log2 of the prim's projected size: a prim
+// _refinePixels high on screen gets level 0, twice that level 1 and so on.
+// With several views the largest projection wins.
+void HDHost::_UpdateRefineLevels(const std::vector<char> &visible) {
+  // Levels only change once the projected size is this far (in levels)
+  // past the boundary, so a prim near a threshold does not refine and
+  // unrefine on every small camera move.
+  const double hysteresis = 0.25;
+  struct Eye {
+    pxr::GfVec3d position;
+    // pixels per unit of size at unit distance
+    double scale;
+  };
+  std::vector<Eye> eyes;
+  for (const auto &view : _views) {
+    if (view.height > 0) {
+      const auto frustum = view.Frustum(_stageBounds);
+      eyes.push_back({frustum.GetPosition(),
+                      view.height / frustum.GetWindow().GetSize()[1]});
+    }
+  }
+
+  for (size_t i = 0; i < _cullCandidates.size(); ++i) {
+    const auto &candidate = _cullCandidates[i];
+    if (!visible[i] || !candidate.prim.IsA<pxr::UsdGeomMesh>()) {
+      // culled prims are not synced; keep their level
+      continue;
+    }
+    const auto range = candidate.bounds.ComputeAlignedRange();
+    if (range.IsEmpty()) {
+      continue;
+    }
+
+    const double radius = range.GetSize().GetLength() * 0.5;
+    double level = 0.0;
+    for (const auto &eye : eyes) {
+      const double distance = (range.GetMidpoint() - eye.position).GetLength();
+      if (distance <= radius) {
+        level = _maxRefineLevel;
+        break;
+      }
+      const double pixels = 2.0 * radius / distance * eye.scale;
+      level = std::max(level, std::log2(std::max(pixels, 1.0) / _refinePixels));
+    }
+
+    const auto path = candidate.prim.GetPath();
+    auto it = _refineLevels.find(path);
+    int refineLevel;
+    if (it == _refineLevels.end()) {
+      refineLevel = int(std::lround(level));
+    } else if (std::abs(level - it->second) > 0.5 + hysteresis) {
+      refineLevel = int(std::lround(level));
+    } else {
+      continue;
+    }
+    refineLevel = std::min(std::max(refineLevel, 0), _maxRefineLevel);
+    if (it != _refineLevels.end() && it->second == refineLevel) {
+      continue;
+    }
+    _refineLevels[path] = refineLevel;
+    _sceneDelegate->SetRefineLevel(path, refineLevel);
+  }
+}
+
+void HDHost::Play(double fps) {
+  _playing = true;
+  _targetFps = fps;
+  _time = pxr::UsdTimeCode::Default();
+}
+
+void HDHost::Stop() {
+  if (_playing && _playedFrames > 1) {
+    _ReportPlayback();
+  }
+  _playing = false;
+  _playedFrames = 0;
+}
+
+void HDHost::_AdvancePlayback() {
+  if (_targetFps <= 0.0) {
+    _targetFps = _stage->GetTimeCodesPerSecond();
+  }
+  const double start = _stage->GetStartTimeCode();
+  const double end = _stage->GetEndTimeCode();
+
+  auto now = std::chrono::steady_clock::now();
+  if (_playedFrames > 0) {
+    // The interval between two Draw calls is what the user sees, including
+    // the swap and anything the window does between paints.
+    const double ms =
+        std::chrono::duration<double, std::milli>(now - _frameStart).count();
+    if (ms > 1000.0 / _targetFps) {
+      ++_missedFrames;
+    }
+  }
+  _frameStart = now;
+
+  double next = _time.IsDefault() ? start : _time.GetValue() + 1.0;
+  if (_time.IsDefault() || next > end) {
+    if (_playedFrames > 1) {
+      _ReportPlayback();
+    }
+    next = start;
+    _passStart = now;
+    _playedFrames = 0;
+    _missedFrames = 0;
+    _prefetchedUntil = start;
+  }
+  _time = pxr::UsdTimeCode(next);
+  ++_playedFrames;
+}
+
+void HDHost::_ReportPlayback() {
+  // The first frame of a pass starts the clock.
+  const size_t intervals = _playedFrames - 1;
+  const double seconds = std::chrono::duration<double>(
+                             _frameStart - _passStart)
+                             .count();
+  const double fps = seconds > 0.0 ? intervals / seconds : 0.0;
+  std::cout << "playback: " << _playedFrames << " frames, " << fps
+            << " fps (target " << _targetFps << "), " << _missedFrames
+            << " frames over budget: target "
+            << (_missedFrames == 0 ? "held" : "missed") << ", prefetch "
+            << _prefetchFrames << " frames" << std::endl;
+}
+
+// The read-ahead goes through a stage of its own on the same layers, with
+// the same mask and load set, so it never races the payload loads and
+// session layer edits of _stage, and shares the crate data and value clip
+// layers those reads warm. Only the detached task running Read touches
+// stage and animated, and one runs at a time.
+struct HDHost::Prefetch {
+  pxr::SdfLayerRefPtr rootLayer;
+  pxr::UsdStagePopulationMask mask;
+  pxr::SdfPathSet loadSet;
+  pxr::UsdStageRefPtr stage;
+  std::vector<pxr::UsdAttributeQuery> animated;
+  std::atomic<bool> busy{false};
+  std::atomic<bool> cancel{false};
+
+  void Read(double from, double to) {
+    if (!stage) {
+      stage = mask.IsEmpty()
+                  ? pxr::UsdStage::Open(rootLayer, pxr::UsdStage::LoadNone)
+                  : pxr::UsdStage::OpenMasked(rootLayer, mask,
+                                              pxr::UsdStage::LoadNone);
+      if (!stage) {
+        return;
+      }
+      stage->LoadAndUnload(loadSet, pxr::SdfPathSet());
+      for (auto prim : stage->Traverse()) {
+        if (cancel) {
+          return;
+        }
+        for (auto &attr : prim.GetAttributes()) {
+          if (attr.ValueMightBeTimeVarying()) {
+            // the query caches where the value resolves from
+            animated.emplace_back(attr);
+          }
+        }
+      }
+    }
+    pxr::WorkParallelForN(animated.size(), [this, from, to](size_t begin,
+                                                            size_t end) {
+      pxr::VtValue value;
+      for (size_t i = begin; i < end && !cancel; ++i) {
+        for (double t = from; t <= to; t += 1.0) {
+          animated[i].Get(&value, t);
+        }
+      }
+    });
+  }
+};
+
+// Nothing waits for the read-ahead: a task still running when the window
+// moves on is skipped over, and a cancelled one is dropped with the last
+// reference to its state.
+void HDHost::_PrefetchAhead() {
+  if (_prefetchFrames <= 0 || !_pendingPayloads.empty()) {
+    // the load set is still changing
+    return;
+  }
+  if (!_prefetch || _prefetchVersion != _sceneVersion) {
+    _CancelPrefetch();
+    _prefetch = std::make_shared<Prefetch>();
+    _prefetch->rootLayer = _stage->GetRootLayer();
+    _prefetch->mask = _stage->GetPopulationMask();
+    _prefetch->loadSet = _stage->GetLoadSet();
+    _prefetchVersion = _sceneVersion;
+    _prefetchedUntil = _time.GetValue();
+  }
+
+  const double from = std::max(_prefetchedUntil, _time.GetValue()) + 1.0;
+  const double to =
+      std::min(_time.GetValue() + _prefetchFrames, _stage->GetEndTimeCode());
+  if (from > to || _prefetch->busy) {
+    return;
+  }
+  _prefetchedUntil = to;
+  _prefetch->busy = true;
+  pxr::WorkRunDetachedTask([prefetch = _prefetch, from, to]() {
+    prefetch->Read(from, to);
+    prefetch->busy = false;
+  });
+}
+
+void HDHost::_CancelPrefetch() {
+  if (_prefetch) {
+    _prefetch->cancel = true;
+    _prefetch = nullptr;
+  }
+}
+
+void HDHost::SetConvergenceBudget(double milliseconds) {
+  _convergenceBudgetMs = milliseconds;
+  for (auto &view : _views) {
+    if (view.engine) {
+      view.engine->SetConvergenceBudget(milliseconds);
+    }
+  }
+}
+
+bool HDHost::IsComplete(size_t view) const {
+  return _stage && _pendingPayloads.empty() && view < _views.size() &&
+         _views[view].engine && _views[view].engine->IsConverged();
+}
+
+bool HDHost::ReadColor(size_t view, int *width, int *height,
+                       std::vector<float> *rgba) {
+  if (view >= _views.size() || !_views[view].engine) {
+    return false;
+  }
+  return _views[view].engine->ReadColor(width, height, rgba);
+}
+
+void HDHost::StartCapture(const std::string &path, size_t view) {
+  _views[view].capturePath = path;
+  if (_views[view].engine) {
+    _views[view].engine->StartCapture(path);
+  }
+}
+
+void HDHost::StopCapture(size_t view) {
+  _views[view].capturePath.clear();
+  if (_views[view].engine) {
+    _views[view].engine->StopCapture();
+  }
+}
+
+const FrameTimingRing *HDHost::GetFrameTimings(size_t view) const {
+  if (view >= _views.size() || !_views[view].engine) {
+    return nullptr;
+  }
+  return &_views[view].engine->FrameTimings();
+}
+
+// GL_SAMPLE_FRAME_TIMINGS=<file>.csv or <file>.json writes the frame
+// timings of each view when the host shuts down. Views other than the
+// first get their index appended to the file name.
+void HDHost::_DumpFrameTimings() const {
+  const std::string path = pxr::TfGetenv("GL_SAMPLE_FRAME_TIMINGS");
+  if (path.empty()) {
+    return;
+  }
+  const size_t dot = path.rfind('.');
+  const std::string stem = path.substr(0, dot);
+  const std::string extension =
+      dot == std::string::npos ? "" : path.substr(dot);
+  for (size_t i = 0; i < _views.size(); ++i) {
+    if (!_views[i].engine) {
+      continue;
+    }
+    const std::string file =
+        i == 0 ? path : stem + "_view" + std::to_string(i) + extension;
+    std::ofstream out(file);
+    if (!out) {
+      std::cerr << "cannot write frame timings to " << file << std::endl;
+      continue;
+    }
+    const auto &timings = _views[i].engine->FrameTimings();
+    if (extension == ".json") {
+      timings.WriteJson(out);
+    } else {
+      timings.WriteCsv(out);
+    }
+  }
+}
+
+void HDHost::SetPopulationMask(const pxr::UsdStagePopulationMask &mask) {
+  _populationMask = mask;
+}
+
+void HDHost::SetExcludedPrimTypes(const pxr::TfTokenVector &typeNames) {
+  _excludedTypes.clear();
+  for (const auto &name : typeNames) {
+    const pxr::TfType type = pxr::UsdSchemaRegistry::GetTypeFromName(name);
+    if (type.IsUnknown()) {
+      std::cerr << "unknown prim type " << name << std::endl;
+      continue;
+    }
+    _excludedTypes.push_back(type);
+  }
+}
+
+void HDHost::SetExcludedPurposes(const pxr::TfTokenVector &purposes) {
+  _excludedPurposes = purposes;
+}
+
+void HDHost::SetPayloadBudget(double milliseconds) {
+  _payloadBudgetMs = milliseconds;
 }
 
 void HDHost::MousePress(int button, int x, int y, int modKeys) {
-  _camera.MousePress(button, x, y, modKeys);
+  _views[0].camera.MousePress(button, x, y, modKeys);
 }
 
 void HDHost::MouseRelease(int button, int x, int y, int modKeys) {
-  _camera.MouseRelease(button, x, y, modKeys);
+  _views[0].camera.MouseRelease(button, x, y, modKeys);
 }
 
 void HDHost::MouseMove(int x, int y, int modKeys) {
-  _camera.MouseMove(x, y, modKeys);
+  _views[0].camera.MouseMove(x, y, modKeys);
 }
@@ -1,21 +1,265 @@
 #pragma once
 #include "Camera.h"
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/usd/usd/notice.h>
 #include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/stagePopulationMask.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <pxr/usd/usdGeom/tokens.h>
 #include <pxr/usdImaging/usdImaging/delegate.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
-class HDHost {
+class FrameTimingRing;
+class GLEngineImpl;
+class GLEngineShared;
+
+class HDHost : public pxr::TfWeakBase {
   pxr::UsdStageRefPtr _stage;
+  // Load opens the stage with UsdStage::LoadNone on a worker thread, Draw
+  // picks it up once it has composed.
+  std::future<pxr::UsdStageRefPtr> _opening;
+  // Only the masked subtrees are composed; empty composes everything.
+  pxr::UsdStagePopulationMask _populationMask;
+  // Prims of these types or authored purposes are left out of the render
+  // index, together with their subtrees.
+  std::vector<pxr::TfType> _excludedTypes;
+  pxr::TfTokenVector _excludedPurposes;
+  pxr::SdfPathVector _excludedPrimPaths;
   pxr::UsdImagingDelegate *_sceneDelegate = nullptr;
-  CameraView _camera;
-  class GLEngineImpl *_engine = nullptr;
+  // render index shared by all the views
+  std::shared_ptr<GLEngineShared> _shared;
+  bool _headless = false;
+
+  // Render on demand: a frame is rendered only when one of these differs
+  // from the last rendered frame, or the renderer has not converged yet.
+  // Otherwise the last frame is blitted again.
+  struct DrawState {
+    uint64_t camera = 0;
+    uint64_t scene = 0;
+    pxr::UsdTimeCode time;
+    int width = 0;
+    int height = 0;
+    bool operator==(const DrawState &rhs) const {
+      return camera == rhs.camera && scene == rhs.scene && time == rhs.time &&
+             width == rhs.width && height == rhs.height;
+    }
+  };
+
+  // A view draws the shared scene with its own camera and task controller.
+  struct View {
+    CameraView camera;
+    std::unique_ptr<GLEngineImpl> engine;
+    DrawState lastDraw;
+    bool hasDrawn = false;
+    // size of the last Draw, used by Update for culling and LOD
+    int width = 0;
+    int height = 0;
+    // image sequence being recorded, empty when not capturing
+    std::string capturePath;
+    pxr::GfFrustum Frustum(const pxr::GfRange3d &bounds) const {
+      return camera.Frustum(double(width) / std::max(height, 1), bounds);
+    }
+  };
+  // A deque, so AddView leaves the references from Camera() valid.
+  std::deque<View> _views;
+  // bumped on every stage change the UsdImagingDelegate will pick up
+  uint64_t _sceneVersion = 0;
+  // bumped only by the changes that can move a bound, see _AffectsBounds
+  uint64_t _boundsVersion = 0;
+  // bumped by Load and by resyncs that do not come from _LoadPayloads
+  uint64_t _resyncVersion = 0;
+  pxr::TfNotice::Key _objectsChangedKey;
+  double _convergenceBudgetMs = 0.0;
+
+  // Unloaded payloads, loaded nearest to the camera first. Prims without
+  // bounds sort last.
+  struct Payload {
+    pxr::SdfPath path;
+    pxr::GfVec3d center;
+    bool hasBounds = false;
+  };
+  std::vector<Payload> _pendingPayloads;
+  double _payloadBudgetMs = 8.0;
+  // Set while _LoadPayloads edits the stage. Its notices leave the bounds
+  // and the cull candidates alone; the loaded subtrees are added to them
+  // incrementally instead, see _UpdateBounds.
+  bool _loadingPayloads = false;
+  // loaded since the last _UpdateBounds
+  pxr::SdfPathVector _loadedPayloads;
+
+  // Playback: each Draw advances one time code through the stage's time
+  // range. The UsdImagingDelegate dirties and re-reads only the
+  // time-varying prims.
+  pxr::UsdTimeCode _time;
+  bool _playing = false;
+  double _targetFps = 0.0;
+  // The time samples of the next _prefetchFrames frames are read ahead on
+  // worker threads, which pages in crate data and opens value clips before
+  // UsdImaging asks for them, see _PrefetchAhead. 0 turns it off.
+  struct Prefetch;
+  std::shared_ptr<Prefetch> _prefetch;
+  int _prefetchFrames = 8;
+  double _prefetchedUntil = 0.0;
+  uint64_t _prefetchVersion = 0;
+  // frame rate measurement over one pass through the time range
+  std::chrono::steady_clock::time_point _passStart;
+  std::chrono::steady_clock::time_point _frameStart;
+  size_t _playedFrames = 0;
+  size_t _missedFrames = 0;
+
+  void _AdvancePlayback();
+  void _PrefetchAhead();
+  void _CancelPrefetch();
+  void _ReportPlayback();
+  // Frustum culling: prims whose world bounds are outside every view are
+  // invised on the UsdImagingDelegate, so Hydra neither syncs nor draws
+  // them. Candidates are gprims, point instancers and instances; bounds
+  // are recomputed when the scene or the time changes, the frustum test
+  // whenever a view does.
+  struct CullCandidate {
+    pxr::UsdPrim prim;
+    pxr::GfBBox3d bounds;
+  };
+  // purposes drawn by the task controller's default render tags
+  pxr::UsdGeomBBoxCache _bboxCache{
+      pxr::UsdTimeCode::Default(),
+      {pxr::UsdGeomTokens->default_, pxr::UsdGeomTokens->proxy},
+      /*useExtentsHint*/ true};
+  // World bound of the whole stage, for framing and the clip planes. The
+  // cache keeps per-prim bounds across frames: it is cleared only when
+  // _boundsVersion moves, and recomputes only time-varying prims when the
+  // time does. Loaded payloads are unioned in.
+  pxr::GfRange3d _stageBounds;
+  // payloads were unioned in since the cache was last cleared
+  bool _hasIncrementalBounds = false;
+  uint64_t _cachedBoundsVersion = 0;
+  pxr::UsdTimeCode _boundsTime;
+  bool _hasBounds = false;
+  // bumped whenever _bboxCache was recomputed
+  uint64_t _boundsGeneration = 0;
+  uint64_t _culledBoundsGeneration = 0;
+  // views to frame once bounds are known
+  std::vector<size_t> _framePending;
+  std::vector<CullCandidate> _cullCandidates;
+  // found in the loaded payloads, appended by _UpdateCulling
+  std::vector<CullCandidate> _newCullCandidates;
+  uint64_t _culledResyncVersion = 0;
+  pxr::SdfPathVector _invisedPrimPaths;
+  bool _culling = true;
+  bool _hasCulled = false;
+  std::vector<DrawState> _cullStates;
+
+  // Automatic LOD: meshes get a refine level from their projected size,
+  // see _UpdateRefineLevels. Levels are kept per prim for the hysteresis.
+  // Off by default: changing a level re-refines the mesh, which the
+  // fallback level never does.
+  bool _autoRefine = false;
+  int _maxRefineLevel = 4;
+  double _refinePixels = 128.0;
+  std::unordered_map<pxr::SdfPath, int, pxr::SdfPath::Hash> _refineLevels;
+
+  DrawState _GetDrawState(const View &view) const;
+  static bool _AffectsBounds(const pxr::SdfPath &changedPath);
+  void _UpdateBounds();
+  void _UpdateCulling();
+  static void _AppendCullCandidates(const pxr::UsdPrim &root,
+                                    std::vector<CullCandidate> *candidates);
+  void _UpdateRefineLevels(const std::vector<char> &visible);
+  bool _FinishOpen();
+  bool _IsExcluded(const pxr::UsdPrim &prim) const;
+  // session layer opinions, collected while traversing
+  struct SessionEdits {
+    pxr::SdfPathVector addProxies;
+    pxr::SdfPathVector removeProxies;
+    pxr::SdfPathVector deactivate;
+  };
+  void _QueuePayloads(const pxr::UsdPrim &root, pxr::SdfPathVector *excluded,
+                      pxr::SdfPathVector *proxies);
+  void _LoadPayloads();
+  void _ApplySessionEdits(const SessionEdits &edits);
+  void _DumpFrameTimings() const;
+  void _OnObjectsChanged(const pxr::UsdNotice::ObjectsChanged &notice,
+                         const pxr::UsdStageWeakPtr &sender);
 
 public:
   HDHost();
   ~HDHost();
   void Shutdown();
   void Load(const char *path);
-  void Draw(int w, int h);
+  // Loading options, used by the next Load.
+  void SetPopulationMask(const pxr::UsdStagePopulationMask &mask);
+  // schema type names such as "Mesh"; derived types are excluded too
+  void SetExcludedPrimTypes(const pxr::TfTokenVector &typeNames);
+  // e.g. "guide", "proxy"
+  void SetExcludedPurposes(const pxr::TfTokenVector &purposes);
+  // Single view: Update followed by Draw of view 0.
+  bool Draw(int w, int h);
+
+  // Multi-viewport hosts add views, call Update once per frame and then
+  // Draw each view. Views share the Hgi, the render index and the synced
+  // scene. View 0 always exists; payloads load nearest to its camera.
+  size_t AddView();
+  size_t GetViewCount() const { return _views.size(); }
+  // Per-frame scene work: payload loading, playback, scene edits, culling
+  // and LOD. Culling uses each view's size from its last Draw.
+  void Update();
+  // Returns false when nothing changed and the last frame was blitted
+  // again, so the host can idle.
+  bool Draw(size_t view, int w, int h);
+
+  // Render without a GL context through a CPU render delegate, see
+  // GLEngineShared. Must be set before the first Update.
+  void SetHeadless(bool headless) { _headless = headless; }
+  // Load has been called and the stage is still composing.
+  bool IsOpening() const { return _opening.valid(); }
+  bool IsOpen() const { return bool(_stage); }
+  // The stage is open, all payloads are loaded and the view's last frame
+  // has converged.
+  bool IsComplete(size_t view = 0) const;
+  // see GLEngineImpl::ReadColor
+  bool ReadColor(size_t view, int *width, int *height,
+                 std::vector<float> *rgba);
+  // see GLEngineImpl::SetConvergenceBudget
+  void SetConvergenceBudget(double milliseconds);
+  // time spent loading payloads per frame, the nearest one is always loaded
+  void SetPayloadBudget(double milliseconds);
+  // Skip the prims whose bounds are outside every view, on by default.
+  void SetCulling(bool enable);
+  // Refine meshes by their projected size, up to maxRefineLevel (0..8).
+  // When off, all prims use the fallback refine level.
+  void SetAutoRefine(bool enable, int maxRefineLevel = 4);
+  bool IsAutoRefining() const { return _autoRefine; }
+  // Play the stage's time range in a loop. fps 0 uses the stage's
+  // timeCodesPerSecond. Each pass reports whether fps was held.
+  void Play(double fps = 0.0);
+  // time codes read ahead during playback, 0 turns the read-ahead off
+  void SetPrefetchFrames(int frames) { _prefetchFrames = std::max(frames, 0); }
+  void Stop();
+  bool IsPlaying() const { return _playing; }
+  // Fit the view to the stage's bounds, keeping its rotation. Views are
+  // framed when added and on load, once the stage is open.
+  void Frame(size_t view = 0);
+  // mouse input for view 0
   void MousePress(int button, int x, int y, int modKeys);
   void MouseRelease(int button, int x, int y, int modKeys);
   void MouseMove(int x, int y, int modKeys);
+  CameraView &Camera(size_t view) { return _views[view].camera; }
+  // Record the frames of a view to an image sequence, see FrameCapture.
+  // The GL context must be current when stopping.
+  void StartCapture(const std::string &path, size_t view = 0);
+  void StopCapture(size_t view = 0);
+  bool IsCapturing(size_t view = 0) const {
+    return !_views[view].capturePath.empty();
+  }
+  // null until the view has drawn
+  const FrameTimingRing *GetFrameTimings(size_t view) const;
 };
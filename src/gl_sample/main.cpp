@@ -1,16 +1,82 @@
 #include "HDHost.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <pxr/base/tf/stringUtils.h>
 #include <pxr/imaging/garch/glDebugWindow.h>
+#include <pxr/imaging/hio/image.h>
+#include <thread>
+#include <vector>
+
+// What to compose and sync, shared by the window and --headless:
+//   --mask <primPath>           compose only this subtree (repeatable)
+//   --exclude-type <typeName>   skip prims of this schema type (repeatable)
+//   --exclude-purpose <purpose> skip prims with this purpose (repeatable)
+//   --auto-refine               refine meshes by their projected size
+//   --prefetch <frames>         time codes read ahead in playback, 0 is off
+struct LoadOptions {
+  pxr::SdfPathVector mask;
+  pxr::TfTokenVector excludedTypes;
+  pxr::TfTokenVector excludedPurposes;
+  bool autoRefine = false;
+  int prefetchFrames = 8;
+
+  // Returns the arguments that are not load options.
+  std::vector<const char *> Parse(int argc, char *argv[]) {
+    std::vector<const char *> rest;
+    for (int i = 1; i < argc; ++i) {
+      const bool hasValue = i + 1 < argc;
+      if (hasValue && std::strcmp(argv[i], "--mask") == 0) {
+        const pxr::SdfPath path(argv[++i]);
+        if (path.IsAbsolutePath() && path.IsPrimPath()) {
+          mask.push_back(path);
+        } else {
+          std::cerr << "ignoring mask " << argv[i] << std::endl;
+        }
+      } else if (hasValue && std::strcmp(argv[i], "--exclude-type") == 0) {
+        excludedTypes.emplace_back(argv[++i]);
+      } else if (hasValue &&
+                 std::strcmp(argv[i], "--exclude-purpose") == 0) {
+        excludedPurposes.emplace_back(argv[++i]);
+      } else if (hasValue && std::strcmp(argv[i], "--prefetch") == 0) {
+        prefetchFrames = std::atoi(argv[++i]);
+      } else if (std::strcmp(argv[i], "--auto-refine") == 0) {
+        autoRefine = true;
+      } else {
+        rest.push_back(argv[i]);
+      }
+    }
+    return rest;
+  }
+
+  void Apply(HDHost &host) const {
+    if (!mask.empty()) {
+      host.SetPopulationMask(
+          pxr::UsdStagePopulationMask(mask.begin(), mask.end()));
+    }
+    host.SetExcludedPrimTypes(excludedTypes);
+    host.SetExcludedPurposes(excludedPurposes);
+    host.SetAutoRefine(autoRefine);
+    host.SetPrefetchFrames(prefetchFrames);
+  }
+};
 
 class UnitTestWindow : public pxr::GarchGLDebugWindow {
 
   HDHost _host;
 
 public:
-  UnitTestWindow(int w, int h, const char *usdFile)
+  UnitTestWindow(int w, int h, const char *usdFile,
+                 const LoadOptions &options)
       : GarchGLDebugWindow("UsdImagingGL Test", w, h) {
 
+    options.Apply(_host);
     _host.Load(usdFile);
+    // Keep the window responsive (~60Hz) while a progressive renderer
+    // converges.
+    _host.SetConvergenceBudget(16.0);
   }
 
   ~UnitTestWindow() {
@@ -26,13 +92,39 @@ public:
     //
     int width = GetWidth();
     int height = GetHeight();
-    _host.Draw(width, height);
+    if (!_host.Draw(width, height)) {
+      // The debug window repaints and swaps in a busy loop; when nothing
+      // changed, sleep about a frame instead of spinning. Input is still
+      // picked up at ~60Hz.
+      std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
   }
 
   virtual void OnKeyRelease(int key) {
     switch (key) {
     case 'q':
       ExitApp();
+      break;
+    case 'c':
+      if (_host.IsCapturing()) {
+        _host.StopCapture();
+      } else {
+        _host.StartCapture("frame.png");
+      }
+      break;
+    case 'p':
+      if (_host.IsPlaying()) {
+        _host.Stop();
+      } else {
+        _host.Play();
+      }
+      break;
+    case 'f':
+      _host.Frame();
+      break;
+    case 'r':
+      _host.SetAutoRefine(!_host.IsAutoRefining());
+      break;
     }
   }
 
@@ -49,12 +141,91 @@ public:
   }
 };
 
+// gl_sample --headless <image> <usdFile> [width height [seconds]]
+// Renders one converged frame without a window or GL context and writes it
+// to <image> (.exr keeps float color). Gives up with exit code 2 when the
+// frame has not converged within the time limit, 300 seconds by default.
+static int RenderHeadless(const char *imageFile, const char *usdFile,
+                          int width, int height, double timeLimit,
+                          const LoadOptions &options) {
+  HDHost host;
+  host.SetHeadless(true);
+  options.Apply(host);
+  host.Load(usdFile);
+
+  // The stage opens on a worker thread and its payloads load over several
+  // frames.
+  const auto start = std::chrono::steady_clock::now();
+  while (!host.IsComplete()) {
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    if (seconds > timeLimit) {
+      std::cerr << "not converged after " << timeLimit << " seconds"
+                << std::endl;
+      host.Shutdown();
+      return 2;
+    }
+    if (host.IsOpening()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } else if (!host.IsOpen()) {
+      std::cerr << "cannot open " << usdFile << std::endl;
+      return 1;
+    }
+    host.Draw(width, height);
+  }
+
+  std::vector<float> rgba;
+  if (!host.ReadColor(0, &width, &height, &rgba)) {
+    std::cerr << "no color output" << std::endl;
+    return 1;
+  }
+
+  const bool exr = pxr::TfStringEndsWith(imageFile, ".exr");
+  std::vector<uint8_t> rgba8;
+  pxr::HioImage::StorageSpec storage;
+  storage.width = width;
+  storage.height = height;
+  storage.depth = 1;
+  // render buffer rows are bottom-up
+  storage.flipped = true;
+  if (exr) {
+    storage.format = pxr::HioFormatFloat32Vec4;
+    storage.data = rgba.data();
+  } else {
+    rgba8.resize(rgba.size());
+    for (size_t i = 0; i < rgba.size(); ++i) {
+      rgba8[i] = uint8_t(std::min(std::max(rgba[i], 0.0f), 1.0f) * 255.0f +
+                         0.5f);
+    }
+    storage.format = pxr::HioFormatUNorm8Vec4;
+    storage.data = rgba8.data();
+  }
+  auto image = pxr::HioImage::OpenForWriting(imageFile);
+  if (!image || !image->Write(storage)) {
+    std::cerr << "cannot write " << imageFile << std::endl;
+    return 1;
+  }
+  host.Shutdown();
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
-  if (argc < 2) {
+  LoadOptions options;
+  const auto args = options.Parse(argc, argv);
+
+  if (args.size() >= 3 && std::strcmp(args[0], "--headless") == 0) {
+    const int width = args.size() >= 5 ? std::atoi(args[3]) : 640;
+    const int height = args.size() >= 5 ? std::atoi(args[4]) : 480;
+    const double timeLimit = args.size() >= 6 ? std::atof(args[5]) : 300.0;
+    return RenderHeadless(args[1], args[2], width, height, timeLimit,
+                          options);
+  }
+  if (args.empty()) {
     return 1;
   }
 
-  auto context = UnitTestWindow(640, 480, argv[1]);
+  auto context = UnitTestWindow(640, 480, args[0], options);
   context.Init();
   context.Run();
 
@@ -2,6 +2,7 @@
 #include "unitTestDelegate.h"
 #include "pxr/imaging/hdx/renderTask.h"
 #include <pxr/imaging/garch/glDebugWindow.h>
+#include <iostream>
 
 static pxr::GfMatrix4d
 _GetTranslate(float tx, float ty, float tz)
@@ -31,6 +32,13 @@ void SceneManager::Uninit()
     }
 }
 
+void SceneManager::SetStressScene(const StressSceneParams &params)
+{
+    _stress = params;
+    // the whole scatter box in view
+    SetCameraTranslate(pxr::GfVec3f(0, 0, -1.5f * params.spread));
+}
+
 void SceneManager::CreateDelegate(pxr::HdRenderIndex *renderIndex)
 {
     _sceneDelegate = new pxr::Hdx_UnitTestDelegate(renderIndex);
@@ -66,6 +74,26 @@ void SceneManager::CreateDelegate(pxr::HdRenderIndex *renderIndex)
                                  black, blue, magenta, red};
     pxr::VtValue vertColor = pxr::VtValue(_BuildArray(&vertColors[0],
                                                       sizeof(vertColors) / sizeof(vertColors[0])));
+
+    if (_stress.kind != StressSceneParams::Kind::None)
+    {
+        StressSceneStats stats = GenerateStressScene(_sceneDelegate, _stress);
+        std::cout << "stress scene: " << stats.rprims << " rprims, "
+                  << stats.instancers << " instancers, "
+                  << stats.instances << " instances, "
+                  << stats.faces << " faces, built in "
+                  << stats.seconds * 1000.0 << " ms\n";
+        return;
+    }
+
+    _sceneDelegate->AddCube(pxr::SdfPath("/cube0"), _GetTranslate(5, 0, 5),
+                            pxr::SdfPath(), faceColor, pxr::HdInterpolationUniform);
+    _sceneDelegate->AddCube(pxr::SdfPath("/cube1"), _GetTranslate(-5, 0, 5),
+                            pxr::SdfPath(), faceColor, pxr::HdInterpolationUniform);
+    _sceneDelegate->AddCube(pxr::SdfPath("/cube2"), _GetTranslate(-5, 0, -5),
+                            pxr::SdfPath(), vertColor, pxr::HdInterpolationVertex);
+    _sceneDelegate->AddTet(pxr::SdfPath("/tet0"), _GetTranslate(5, 0, -5));
+    _sceneDelegate->AddGrid(pxr::SdfPath("/grid0"), _GetTranslate(0, 0, 0));
 }
 
 pxr::HdSceneDelegate *SceneManager::Prepare(int width, int height)
@@ -77,6 +105,7 @@ pxr::HdSceneDelegate *SceneManager::Prepare(int width, int height)
 
     pxr::GfMatrix4d projMatrix = frustum.ComputeProjectionMatrix();
     _sceneDelegate->SetCamera(viewMatrix, projMatrix);
+    _sceneDelegate->PublishEdits();
 
     pxr::SdfPath renderSetupTask("/renderSetupTask");
     // pxr::HdxRenderTaskParams param = _sceneDelegate->GetTaskParam(
@@ -2,6 +2,7 @@
 #include "pxr/base/gf/frustum.h"
 #include "pxr/base/gf/matrix4d.h"
 #include "pxr/base/gf/vec3f.h"
+#include "StressScene.h"
 #include <pxr/imaging/hd/tokens.h>
 
 PXR_NAMESPACE_OPEN_SCOPE
@@ -12,8 +13,9 @@ PXR_NAMESPACE_CLOSE_SCOPE
 
 class SceneManager
 {
-    pxr::Hdx_UnitTestDelegate *_sceneDelegate;
+    pxr::Hdx_UnitTestDelegate *_sceneDelegate = nullptr;
     pxr::TfToken _reprName = pxr::HdReprTokens->hull;
+    StressSceneParams _stress;
 
     float _rotate[2] = {0, 0};
     pxr::GfVec3f _translate = pxr::GfVec3f(0, 0, 0);
@@ -24,6 +26,8 @@ public:
     SceneManager();
     ~SceneManager();
     void Uninit();
+    // Build a stress scene instead of the default cubes, before CreateDelegate.
+    void SetStressScene(const StressSceneParams &params);
     void CreateDelegate(pxr::HdRenderIndex *renderIndex);
     pxr::HdSceneDelegate *Prepare(int width, int height);
     void MousePress(int button, int x, int y, int modKeys);
@@ -0,0 +1,257 @@
+#include "StressScene.h"
+#include "unitTestDelegate.h"
+#include "pxr/base/gf/quatd.h"
+#include "pxr/base/tf/stopwatch.h"
+#include "pxr/base/tf/stringUtils.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    const double kTwoPi = 6.283185307179586;
+
+    // std::mt19937 is specified bit for bit, the standard distributions are
+    // not; map its output ourselves to keep scenes identical everywhere.
+    class Random
+    {
+        std::mt19937 _engine;
+
+    public:
+        explicit Random(uint32_t seed) : _engine(seed) {}
+
+        // [0, 1)
+        double Next() { return _engine() / 4294967296.0; }
+        double Uniform(double lo, double hi) { return lo + (hi - lo) * Next(); }
+
+        pxr::GfVec3d Position(double spread)
+        {
+            double x = Uniform(-0.5, 0.5) * spread;
+            double y = Uniform(-0.5, 0.5) * spread;
+            double z = Uniform(-0.5, 0.5) * spread;
+            return pxr::GfVec3d(x, y, z);
+        }
+
+        // uniformly distributed unit quaternion (Shoemake)
+        pxr::GfQuatd Rotation()
+        {
+            double u1 = Next();
+            double u2 = Next() * kTwoPi;
+            double u3 = Next() * kTwoPi;
+            double a = std::sqrt(1.0 - u1), b = std::sqrt(u1);
+            return pxr::GfQuatd(b * std::cos(u3),
+                                pxr::GfVec3d(a * std::sin(u2),
+                                             a * std::cos(u2),
+                                             b * std::sin(u3)));
+        }
+
+        pxr::GfVec3f Color()
+        {
+            float r = float(Uniform(0.2, 1.0));
+            float g = float(Uniform(0.2, 1.0));
+            float b = float(Uniform(0.2, 1.0));
+            return pxr::GfVec3f(r, g, b);
+        }
+    };
+
+    // Scale, rotate then translate, as the instancer applies them.
+    struct Placement
+    {
+        double scale;
+        pxr::GfQuatd rotate;
+        pxr::GfVec3d translate;
+
+        pxr::GfMatrix4d Matrix() const
+        {
+            pxr::GfMatrix4d m = pxr::GfMatrix4d().SetScale(scale);
+            m *= pxr::GfMatrix4d().SetRotate(rotate);
+            m *= pxr::GfMatrix4d().SetTranslate(translate);
+            return m;
+        }
+    };
+
+    Placement RandomPlacement(Random &random, double spread)
+    {
+        Placement placement;
+        placement.scale = random.Uniform(0.5, 1.5);
+        placement.rotate = random.Rotation();
+        placement.translate = random.Position(spread);
+        return placement;
+    }
+
+    // Adds the mesh every scene is made of, returns its face count.
+    size_t AddStressMesh(pxr::Hdx_UnitTestDelegate *delegate,
+                         const pxr::SdfPath &id,
+                         const pxr::GfMatrix4d &transform,
+                         const pxr::SdfPath &instancerId,
+                         const StressSceneParams &params,
+                         const pxr::GfVec3f &color)
+    {
+        const int resolution = params.gridResolution;
+        if (resolution > 0)
+        {
+            delegate->AddGrid(id, transform, resolution, resolution,
+                              instancerId, pxr::VtValue(color));
+            return size_t(resolution) * resolution;
+        }
+        delegate->AddCube(id, transform, instancerId, pxr::VtValue(color));
+        return 6;
+    }
+
+    void SetRandomInstances(pxr::Hdx_UnitTestDelegate *delegate,
+                            const pxr::SdfPath &instancerId, int count,
+                            double spread, Random &random)
+    {
+        pxr::VtIntArray prototypeIndex(count, 0);
+        pxr::VtVec3fArray scale(count);
+        pxr::VtVec4fArray rotate(count);
+        pxr::VtVec3fArray translate(count);
+        for (int i = 0; i < count; ++i)
+        {
+            const Placement placement = RandomPlacement(random, spread);
+            const pxr::GfVec3d &imaginary = placement.rotate.GetImaginary();
+            scale[i] = pxr::GfVec3f(float(placement.scale));
+            rotate[i] = pxr::GfVec4f(float(placement.rotate.GetReal()),
+                                     float(imaginary[0]), float(imaginary[1]),
+                                     float(imaginary[2]));
+            translate[i] = pxr::GfVec3f(placement.translate);
+        }
+        delegate->SetInstancerProperties(instancerId, prototypeIndex, scale,
+                                         rotate, translate);
+    }
+} // namespace
+
+bool StressSceneParams::Parse(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        // all options take at least one value
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        if (std::strcmp(arg, "--meshes") == 0)
+        {
+            kind = Kind::Meshes;
+            count = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--instances") == 0)
+        {
+            kind = Kind::Instances;
+            count = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--nested") == 0 && i + 2 < argc)
+        {
+            kind = Kind::Nested;
+            depth = std::atoi(argv[++i]);
+            count = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--grid") == 0)
+        {
+            gridResolution = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--spread") == 0)
+        {
+            spread = float(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(arg, "--seed") == 0)
+        {
+            seed = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return count > 0 && depth > 0 && gridResolution >= 0 && spread > 0;
+}
+
+void StressSceneParams::PrintUsage(const char *program)
+{
+    std::cerr << "usage: " << program
+              << " [--meshes N | --instances N | --nested DEPTH N]"
+                 " [--grid RES] [--spread SIZE] [--seed SEED]\n";
+}
+
+StressSceneStats GenerateStressScene(pxr::Hdx_UnitTestDelegate *delegate,
+                                     const StressSceneParams &params)
+{
+    StressSceneStats stats;
+    pxr::TfStopwatch watch;
+    watch.Start();
+
+    Random random(params.seed);
+    const pxr::SdfPath root("/stress");
+    size_t faces = 0;
+
+    switch (params.kind)
+    {
+    case StressSceneParams::Kind::None:
+        break;
+
+    case StressSceneParams::Kind::Meshes:
+        for (int i = 0; i < params.count; ++i)
+        {
+            const Placement placement = RandomPlacement(random, params.spread);
+            faces = AddStressMesh(
+                delegate, root.AppendChild(pxr::TfToken(
+                              pxr::TfStringPrintf("mesh%d", i))),
+                placement.Matrix(), pxr::SdfPath(), params, random.Color());
+        }
+        stats.rprims = params.count;
+        stats.instances = params.count;
+        break;
+
+    case StressSceneParams::Kind::Instances:
+    {
+        const pxr::SdfPath instancer =
+            root.AppendChild(pxr::TfToken("instancer"));
+        delegate->AddInstancer(instancer);
+        faces = AddStressMesh(delegate,
+                              root.AppendChild(pxr::TfToken("prototype")),
+                              pxr::GfMatrix4d(1), instancer, params,
+                              random.Color());
+        SetRandomInstances(delegate, instancer, params.count, params.spread,
+                           random);
+        stats.rprims = 1;
+        stats.instancers = 1;
+        stats.instances = params.count;
+        break;
+    }
+
+    case StressSceneParams::Kind::Nested:
+    {
+        // Each level is scattered within a fraction of its parent's spread,
+        // so the leaves cluster around the instances of the level above.
+        pxr::SdfPath parent;
+        double spread = params.spread;
+        stats.instances = 1;
+        for (int level = 0; level < params.depth; ++level)
+        {
+            const pxr::SdfPath instancer = root.AppendChild(
+                pxr::TfToken(pxr::TfStringPrintf("level%d", level)));
+            delegate->AddInstancer(instancer, parent);
+            SetRandomInstances(delegate, instancer, params.count, spread,
+                               random);
+            parent = instancer;
+            spread /= std::cbrt(double(params.count)) + 1.0;
+            stats.instances *= params.count;
+        }
+        faces = AddStressMesh(delegate,
+                              root.AppendChild(pxr::TfToken("prototype")),
+                              pxr::GfMatrix4d(1), parent, params,
+                              random.Color());
+        stats.rprims = 1;
+        stats.instancers = params.depth;
+        break;
+    }
+    }
+
+    watch.Stop();
+    stats.faces = stats.instances * faces;
+    stats.seconds = watch.GetSeconds();
+    return stats;
+}
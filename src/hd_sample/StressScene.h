@@ -0,0 +1,52 @@
+#pragma once
+#include <pxr/pxr.h>
+#include <stddef.h>
+#include <stdint.h>
+
+PXR_NAMESPACE_OPEN_SCOPE
+class Hdx_UnitTestDelegate;
+PXR_NAMESPACE_CLOSE_SCOPE
+
+// A synthetic scene for measuring how Hydra scales with the number of rprims,
+// the number of instances and the mesh density. The same parameters and seed
+// build the same scene on every platform.
+struct StressSceneParams
+{
+    enum class Kind
+    {
+        None,
+        // count independent meshes
+        Meshes,
+        // count instances of one prototype mesh
+        Instances,
+        // depth levels of instancers, each instancing the next count times;
+        // count^depth meshes are drawn
+        Nested,
+    };
+    Kind kind = Kind::None;
+    int count = 1000;
+    int depth = 3;
+    // quads per side of every mesh, 0 draws cubes
+    int gridResolution = 0;
+    // side of the box the meshes are scattered in
+    float spread = 100.0f;
+    uint32_t seed = 1;
+
+    // --meshes N | --instances N | --nested DEPTH N, and optionally
+    // --grid RES, --spread SIZE, --seed SEED. Returns false on bad options.
+    bool Parse(int argc, char *argv[]);
+    static void PrintUsage(const char *program);
+};
+
+struct StressSceneStats
+{
+    size_t rprims = 0;
+    size_t instancers = 0;
+    // meshes drawn, counting every instance
+    double instances = 0;
+    double faces = 0;
+    double seconds = 0;
+};
+
+StressSceneStats GenerateStressScene(pxr::Hdx_UnitTestDelegate *delegate,
+                                     const StressSceneParams &params);
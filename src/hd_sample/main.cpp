@@ -75,11 +75,22 @@ public:
 
 int main(int argc, char *argv[])
 {
+    StressSceneParams stress;
+    if (!stress.Parse(argc, argv))
+    {
+        StressSceneParams::PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
     pxr::TfErrorMark mark;
 
     {
         Drawing drawing;
         SceneManager scene;
+        if (stress.kind != StressSceneParams::Kind::None)
+        {
+            scene.SetStressScene(stress);
+        }
 
         Callback callback;
         callback.OnInitializeGL = [&drawing, &scene](int width, int height) {
@@ -24,6 +24,8 @@
 #include "unitTestDelegate.h"
 
 #include "pxr/base/gf/frustum.h"
+#include "pxr/base/tf/stl.h"
+#include "pxr/base/work/loops.h"
 
 #include "pxr/imaging/hd/engine.h"
 #include "pxr/imaging/hd/mesh.h"
@@ -44,6 +46,9 @@
 #include "pxr/imaging/glf/drawTarget.h"
 #include "pxr/imaging/pxOsd/tokens.h"
 
+#include <algorithm>
+#include <new>
+
 PXR_NAMESPACE_OPEN_SCOPE
 
 TF_DEFINE_PRIVATE_TOKENS(
@@ -51,32 +56,60 @@ TF_DEFINE_PRIVATE_TOKENS(
 
     (renderBufferDescriptor));
 
+// Rows per parallel task, so that each one writes about this many elements.
+static size_t
+_GetRowGrain(size_t rowSize)
+{
+    return std::max<size_t>(1, 16384 / std::max<size_t>(1, rowSize));
+}
+
 static void
 _CreateGrid(int nx, int ny, VtVec3fArray *points,
             VtIntArray *numVerts, VtIntArray *verts)
 {
     // create a unit plane (-1 ~ 1)
-    for (int y = 0; y <= ny; ++y)
-    {
-        for (int x = 0; x <= nx; ++x)
-        {
-            GfVec3f p(2.0 * x / float(nx) - 1.0,
-                      2.0 * y / float(ny) - 1.0,
-                      0);
-            points->push_back(p);
-        }
-    }
-    for (int y = 0; y < ny; ++y)
-    {
-        for (int x = 0; x < nx; ++x)
-        {
-            numVerts->push_back(4);
-            verts->push_back(y * (nx + 1) + x);
-            verts->push_back(y * (nx + 1) + x + 1);
-            verts->push_back((y + 1) * (nx + 1) + x + 1);
-            verts->push_back((y + 1) * (nx + 1) + x);
-        }
-    }
+    // The arrays are sized once and filled in place, row by row in
+    // parallel; nothing is built elsewhere and copied in.
+    const size_t rowPoints = size_t(nx) + 1;
+    const float sx = 2.0f / nx, sy = 2.0f / ny;
+    points->resize(rowPoints * (ny + 1), [&](GfVec3f *first, GfVec3f *) {
+        WorkParallelForN(
+            size_t(ny) + 1,
+            [&](size_t begin, size_t end) {
+                for (size_t y = begin; y < end; ++y)
+                {
+                    GfVec3f *p = first + y * rowPoints;
+                    for (int x = 0; x <= nx; ++x)
+                    {
+                        new (p++) GfVec3f(x * sx - 1.0f, y * sy - 1.0f, 0);
+                    }
+                }
+            },
+            _GetRowGrain(rowPoints));
+    });
+
+    const size_t faces = size_t(nx) * ny;
+    *numVerts = VtIntArray(faces, 4);
+    verts->resize(faces * 4, [&](int *first, int *) {
+        WorkParallelForN(
+            size_t(ny),
+            [&](size_t begin, size_t end) {
+                for (size_t y = begin; y < end; ++y)
+                {
+                    int *v = first + y * nx * 4;
+                    const int row = int(y * rowPoints);
+                    const int next = int(row + rowPoints);
+                    for (int x = 0; x < nx; ++x)
+                    {
+                        *v++ = row + x;
+                        *v++ = row + x + 1;
+                        *v++ = next + x + 1;
+                        *v++ = next + x;
+                    }
+                }
+            },
+            _GetRowGrain(size_t(nx) * 4));
+    });
 }
 
 namespace
@@ -125,19 +158,18 @@ Hdx_UnitTestDelegate::Hdx_UnitTestDelegate(HdRenderIndex *index)
     // Add draw target state tracking support.
     GetRenderIndex().GetChangeTracker().AddState(
         HdStDrawTargetTokens->drawTargetSet);
-
-    // HdRenderIndex &index = GetRenderIndex();
-    index->InsertRprim(HdPrimTypeTokens->mesh, this, SdfPath("/cube0"));
 }
 
 void Hdx_UnitTestDelegate::SetCamera(SdfPath const &cameraId,
                                      GfMatrix4d const &viewMatrix,
                                      GfMatrix4d const &projMatrix)
 {
-    _ValueCache &cache = _valueCacheMap[cameraId];
-    cache[HdCameraTokens->windowPolicy] = VtValue(CameraUtilFit);
-    cache[HdShaderTokens->worldToViewMatrix] = VtValue(viewMatrix);
-    cache[HdShaderTokens->projectionMatrix] = VtValue(projMatrix);
+    _valueCache.Set(cameraId, HdCameraTokens->windowPolicy,
+                    VtValue(CameraUtilFit));
+    _valueCache.Set(cameraId, HdShaderTokens->worldToViewMatrix,
+                    VtValue(viewMatrix));
+    _valueCache.Set(cameraId, HdShaderTokens->projectionMatrix,
+                    VtValue(projMatrix));
 
     GetRenderIndex().GetChangeTracker().MarkSprimDirty(cameraId,
                                                        HdCamera::AllDirty);
@@ -146,33 +178,187 @@ void Hdx_UnitTestDelegate::SetCamera(SdfPath const &cameraId,
 void Hdx_UnitTestDelegate::AddRenderTask(SdfPath const &id)
 {
     GetRenderIndex().InsertTask<HdxRenderTask>(this, id);
-    _ValueCache &cache = _valueCacheMap[id];
-    cache[HdTokens->collection] = HdRprimCollection(HdTokens->geometry,
-                                                    HdReprSelector(HdReprTokens->smoothHull));
+    _valueCache.Set(id, HdTokens->collection,
+                    VtValue(HdRprimCollection(HdTokens->geometry,
+                                              HdReprSelector(HdReprTokens->smoothHull))));
 
     // Don't filter on render tag.
     // XXX: However, this will mean no prim passes if any stage defines a tag
-    cache[HdTokens->renderTags] = TfTokenVector();
+    _valueCache.Set(id, HdTokens->renderTags, VtValue(TfTokenVector()));
 }
 
 void Hdx_UnitTestDelegate::AddRenderSetupTask(SdfPath const &id)
 {
     GetRenderIndex().InsertTask<HdxRenderSetupTask>(this, id);
-    _ValueCache &cache = _valueCacheMap[id];
     HdxRenderTaskParams params;
     params.camera = _cameraId;
     params.viewport = GfVec4f(0, 0, 512, 512);
-    cache[HdTokens->params] = VtValue(params);
+    _valueCache.Set(id, HdTokens->params, VtValue(params));
+}
+
+void Hdx_UnitTestDelegate::AddMesh(SdfPath const &id,
+                                   GfMatrix4d const &transform,
+                                   VtVec3fArray const &points,
+                                   VtIntArray const &numVerts,
+                                   VtIntArray const &verts,
+                                   SdfPath const &instancerId,
+                                   TfToken const &scheme,
+                                   VtValue const &color,
+                                   HdInterpolation colorInterpolation)
+{
+    HdRenderIndex &index = GetRenderIndex();
+    index.InsertRprim(HdPrimTypeTokens->mesh, this, id);
+
+    _Mesh &mesh = _meshes[id];
+    mesh.scheme = scheme;
+    mesh.orientation = HdTokens->rightHanded;
+    mesh.transform = transform;
+    mesh.points = points;
+    mesh.numVerts = numVerts;
+    mesh.verts = verts;
+    mesh.color = color;
+    mesh.colorInterpolation = colorInterpolation;
+    mesh.instancerId = instancerId;
+
+    if (!instancerId.IsEmpty())
+    {
+        _instancers[instancerId].prototypes.push_back(id);
+    }
+}
+
+void Hdx_UnitTestDelegate::AddCube(SdfPath const &id,
+                                   GfMatrix4d const &transform,
+                                   SdfPath const &instancerId,
+                                   VtValue const &color,
+                                   HdInterpolation colorInterpolation)
+{
+    GfVec3f points[] = {
+        GfVec3f(1.0f, 1.0f, 1.0f),
+        GfVec3f(-1.0f, 1.0f, 1.0f),
+        GfVec3f(-1.0f, -1.0f, 1.0f),
+        GfVec3f(1.0f, -1.0f, 1.0f),
+        GfVec3f(-1.0f, -1.0f, -1.0f),
+        GfVec3f(-1.0f, 1.0f, -1.0f),
+        GfVec3f(1.0f, 1.0f, -1.0f),
+        GfVec3f(1.0f, -1.0f, -1.0f),
+    };
+
+    int numVerts[] = {4, 4, 4, 4, 4, 4};
+    int verts[] = {
+        0, 1, 2, 3,
+        4, 5, 6, 7,
+        0, 6, 5, 1,
+        4, 7, 3, 2,
+        0, 3, 7, 6,
+        4, 2, 1, 5,
+    };
+
+    AddMesh(id, transform,
+            _BuildArray(points, sizeof(points) / sizeof(points[0])),
+            _BuildArray(numVerts, sizeof(numVerts) / sizeof(numVerts[0])),
+            _BuildArray(verts, sizeof(verts) / sizeof(verts[0])),
+            instancerId, PxOsdOpenSubdivTokens->none,
+            color, colorInterpolation);
+}
+
+void Hdx_UnitTestDelegate::AddGrid(SdfPath const &id,
+                                   GfMatrix4d const &transform,
+                                   int nx, int ny,
+                                   SdfPath const &instancerId,
+                                   VtValue const &color)
+{
+    // Every grid is the same unit plane placed by its transform, so grids of
+    // a resolution share one set of arrays: VtArray copies only add a
+    // reference.
+    _Grid &grid = _grids[std::make_pair(nx, ny)];
+    if (grid.points.empty())
+    {
+        _CreateGrid(nx, ny, &grid.points, &grid.numVerts, &grid.verts);
+    }
+
+    AddMesh(id, transform, grid.points, grid.numVerts, grid.verts,
+            instancerId, PxOsdOpenSubdivTokens->none,
+            color, HdInterpolationConstant);
+}
+
+void Hdx_UnitTestDelegate::AddTet(SdfPath const &id,
+                                  GfMatrix4d const &transform,
+                                  SdfPath const &instancerId,
+                                  VtValue const &color)
+{
+    GfVec3f points[] = {
+        GfVec3f(1.0f, 1.0f, 1.0f),
+        GfVec3f(-1.0f, -1.0f, 1.0f),
+        GfVec3f(-1.0f, 1.0f, -1.0f),
+        GfVec3f(1.0f, -1.0f, -1.0f),
+    };
+
+    int numVerts[] = {3, 3, 3, 3};
+    int verts[] = {
+        0, 1, 3,
+        0, 2, 1,
+        0, 3, 2,
+        1, 2, 3,
+    };
+
+    AddMesh(id, transform,
+            _BuildArray(points, sizeof(points) / sizeof(points[0])),
+            _BuildArray(numVerts, sizeof(numVerts) / sizeof(numVerts[0])),
+            _BuildArray(verts, sizeof(verts) / sizeof(verts[0])),
+            instancerId, PxOsdOpenSubdivTokens->none,
+            color, HdInterpolationConstant);
+}
+
+void Hdx_UnitTestDelegate::AddInstancer(SdfPath const &id,
+                                        SdfPath const &parentId,
+                                        GfMatrix4f const &rootTransform)
+{
+    HdRenderIndex &index = GetRenderIndex();
+    index.InsertInstancer(this, id);
+
+    _Instancer &instancer = _instancers[id];
+    instancer.rootTransform = rootTransform;
+    instancer.parentId = parentId;
+
+    if (!parentId.IsEmpty())
+    {
+        _instancers[parentId].prototypes.push_back(id);
+    }
+}
+
+void Hdx_UnitTestDelegate::SetInstancerProperties(
+    SdfPath const &id,
+    VtIntArray const &prototypeIndex,
+    VtVec3fArray const &scale,
+    VtVec4fArray const &rotate,
+    VtVec3fArray const &translate)
+{
+    if (!TF_VERIFY(prototypeIndex.size() == scale.size()) ||
+        !TF_VERIFY(prototypeIndex.size() == rotate.size()) ||
+        !TF_VERIFY(prototypeIndex.size() == translate.size()))
+    {
+        return;
+    }
+
+    _Instancer &instancer = _instancers[id];
+    instancer.scale = scale;
+    instancer.rotate = rotate;
+    instancer.translate = translate;
+    instancer.prototypeIndices = prototypeIndex;
+
+    GetRenderIndex().GetChangeTracker().MarkInstancerDirty(id);
 }
 
 GfRange3d
 Hdx_UnitTestDelegate::GetExtent(SdfPath const &id)
 {
     GfRange3d range;
-    VtVec3fArray points;
-    TF_FOR_ALL(it, points)
+    if (_Mesh *mesh = TfMapLookupPtr(_meshes, id))
     {
-        range.UnionWith(*it);
+        TF_FOR_ALL(it, mesh->points)
+        {
+            range.UnionWith(GfVec3d(*it));
+        }
     }
     return range;
 }
@@ -180,6 +366,10 @@ Hdx_UnitTestDelegate::GetExtent(SdfPath const &id)
 GfMatrix4d
 Hdx_UnitTestDelegate::GetTransform(SdfPath const &id)
 {
+    if (_Mesh *mesh = TfMapLookupPtr(_meshes, id))
+    {
+        return mesh->transform;
+    }
     return GfMatrix4d(1);
 }
 
@@ -191,34 +381,51 @@ bool Hdx_UnitTestDelegate::GetVisible(SdfPath const &id)
 HdMeshTopology
 Hdx_UnitTestDelegate::GetMeshTopology(SdfPath const &id)
 {
-    pxr::VtArray<int> vertCountsPerFace;
-    vertCountsPerFace.push_back(3);
-    pxr::VtArray<int> verts;
-    verts.push_back(0);
-    verts.push_back(1);
-    verts.push_back(2);
-    return pxr::HdMeshTopology(pxr::PxOsdOpenSubdivTokens->none, pxr::HdTokens->rightHanded, vertCountsPerFace, verts);
+    HdMeshTopology topology;
+    if (_Mesh *mesh = TfMapLookupPtr(_meshes, id))
+    {
+        topology = HdMeshTopology(mesh->scheme, mesh->orientation,
+                                  mesh->numVerts, mesh->verts);
+    }
+    return topology;
 }
 
 VtValue
 Hdx_UnitTestDelegate::Get(SdfPath const &id, TfToken const &key)
 {
     // tasks
-    _ValueCache *vcache = TfMapLookupPtr(_valueCacheMap, id);
     VtValue ret;
-    if (vcache && TfMapLookup(*vcache, key, &ret))
+    if (_valueCache.Find(id, key, &ret))
     {
         return ret;
     }
 
     // prims
-    if (key == HdTokens->points)
+    if (_Mesh *mesh = TfMapLookupPtr(_meshes, id))
+    {
+        if (key == HdTokens->points)
+        {
+            return VtValue(mesh->points);
+        }
+        if (key == HdTokens->displayColor)
+        {
+            return mesh->color;
+        }
+    }
+    else if (_Instancer *instancer = TfMapLookupPtr(_instancers, id))
     {
-        pxr::VtVec3fArray points;
-        points.push_back(pxr::GfVec3f(0, 0, 0));
-        points.push_back(pxr::GfVec3f(1, 0, 0));
-        points.push_back(pxr::GfVec3f(0, 0, 1));
-        return pxr::VtValue(points);
+        if (key == HdInstancerTokens->instanceScales)
+        {
+            return VtValue(instancer->scale);
+        }
+        if (key == HdInstancerTokens->instanceRotations)
+        {
+            return VtValue(instancer->rotate);
+        }
+        if (key == HdInstancerTokens->instanceTranslations)
+        {
+            return VtValue(instancer->translate);
+        }
     }
 
     return VtValue();
@@ -229,10 +436,28 @@ Hdx_UnitTestDelegate::GetPrimvarDescriptors(SdfPath const &id,
                                             HdInterpolation interpolation)
 {
     HdPrimvarDescriptorVector primvars;
-    if (interpolation == HdInterpolationVertex)
+    if (_Mesh *mesh = TfMapLookupPtr(_meshes, id))
     {
-        primvars.emplace_back(HdTokens->points, interpolation,
-                              HdPrimvarRoleTokens->point);
+        if (interpolation == HdInterpolationVertex)
+        {
+            primvars.emplace_back(HdTokens->points, interpolation,
+                                  HdPrimvarRoleTokens->point);
+        }
+        if (interpolation == mesh->colorInterpolation)
+        {
+            primvars.emplace_back(HdTokens->displayColor, interpolation,
+                                  HdPrimvarRoleTokens->color);
+        }
+    }
+    else if (TfMapLookupPtr(_instancers, id) &&
+             interpolation == HdInterpolationInstance)
+    {
+        primvars.emplace_back(HdInstancerTokens->instanceScales,
+                              interpolation);
+        primvars.emplace_back(HdInstancerTokens->instanceRotations,
+                              interpolation);
+        primvars.emplace_back(HdInstancerTokens->instanceTranslations,
+                              interpolation);
     }
     return primvars;
 }
@@ -242,9 +467,8 @@ VtValue
 Hdx_UnitTestDelegate::GetCameraParamValue(SdfPath const &cameraId,
                                           TfToken const &paramName)
 {
-    _ValueCache *vcache = TfMapLookupPtr(_valueCacheMap, cameraId);
     VtValue ret;
-    if (vcache && TfMapLookup(*vcache, paramName, &ret))
+    if (_valueCache.Find(cameraId, paramName, &ret))
     {
         return ret;
     }
@@ -252,4 +476,71 @@ Hdx_UnitTestDelegate::GetCameraParamValue(SdfPath const &cameraId,
     return VtValue();
 }
 
+/*virtual*/
+SdfPath
+Hdx_UnitTestDelegate::GetInstancerId(SdfPath const &primId)
+{
+    if (_Mesh *mesh = TfMapLookupPtr(_meshes, primId))
+    {
+        return mesh->instancerId;
+    }
+    if (_Instancer *instancer = TfMapLookupPtr(_instancers, primId))
+    {
+        return instancer->parentId;
+    }
+    return SdfPath();
+}
+
+/*virtual*/
+VtIntArray
+Hdx_UnitTestDelegate::GetInstanceIndices(SdfPath const &instancerId,
+                                         SdfPath const &prototypeId)
+{
+    VtIntArray indices;
+    _Instancer *instancer = TfMapLookupPtr(_instancers, instancerId);
+    if (!instancer)
+    {
+        return indices;
+    }
+
+    // transpose prototypeIndices/instances to instanceIndices/prototype
+    const auto found = std::find(instancer->prototypes.begin(),
+                                 instancer->prototypes.end(), prototypeId);
+    if (found == instancer->prototypes.end())
+    {
+        return indices;
+    }
+    const int prototypeIndex = int(found - instancer->prototypes.begin());
+    for (size_t i = 0; i < instancer->prototypeIndices.size(); ++i)
+    {
+        if (instancer->prototypeIndices[i] == prototypeIndex)
+        {
+            indices.push_back(int(i));
+        }
+    }
+    return indices;
+}
+
+/*virtual*/
+GfMatrix4d
+Hdx_UnitTestDelegate::GetInstancerTransform(SdfPath const &instancerId)
+{
+    if (_Instancer *instancer = TfMapLookupPtr(_instancers, instancerId))
+    {
+        return GfMatrix4d(instancer->rootTransform);
+    }
+    return GfMatrix4d(1);
+}
+
+/*virtual*/
+SdfPathVector
+Hdx_UnitTestDelegate::GetInstancerPrototypes(SdfPath const &instancerId)
+{
+    if (_Instancer *instancer = TfMapLookupPtr(_instancers, instancerId))
+    {
+        return instancer->prototypes;
+    }
+    return SdfPathVector();
+}
+
 PXR_NAMESPACE_CLOSE_SCOPE
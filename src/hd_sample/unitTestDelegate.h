@@ -39,8 +39,15 @@
 #include "pxr/base/vt/array.h"
 #include "pxr/base/tf/staticTokens.h"
 
+#include "ValueCache.h"
+
+#include <map>
+#include <utility>
+
 PXR_NAMESPACE_OPEN_SCOPE
 
+using Hdx_UnitTestValueCache = ::ValueCache;
+
 template <typename T>
 static VtArray<T>
 _BuildArray(T values[], int numValues)
@@ -54,12 +61,46 @@ class Hdx_UnitTestDelegate : public HdSceneDelegate
 {
     typedef std::map<SdfPath, SdfPath> SdfPathMap;
 
-    typedef TfHashMap<TfToken, VtValue, TfToken::HashFunctor> _ValueCache;
-    typedef TfHashMap<SdfPath, _ValueCache, SdfPath::Hash> _ValueCacheMap;
-    _ValueCacheMap _valueCacheMap;
+    // task and camera parameters, read lock-free during Sync
+    Hdx_UnitTestValueCache _valueCache;
 
     SdfPath _cameraId;
 
+    struct _Mesh
+    {
+        TfToken scheme;
+        TfToken orientation;
+        GfMatrix4d transform;
+        VtVec3fArray points;
+        VtIntArray numVerts;
+        VtIntArray verts;
+        VtValue color;
+        HdInterpolation colorInterpolation = HdInterpolationConstant;
+        SdfPath instancerId;
+    };
+    struct _Instancer
+    {
+        VtVec3fArray scale;
+        VtVec4fArray rotate;
+        VtVec3fArray translate;
+        VtIntArray prototypeIndices;
+        GfMatrix4f rootTransform = GfMatrix4f(1);
+        // instancer this one is a prototype of, for nesting
+        SdfPath parentId;
+        SdfPathVector prototypes;
+    };
+    std::map<SdfPath, _Mesh> _meshes;
+    std::map<SdfPath, _Instancer> _instancers;
+
+    // unit plane arrays by resolution, shared by every grid, see AddGrid
+    struct _Grid
+    {
+        VtVec3fArray points;
+        VtIntArray numVerts;
+        VtIntArray verts;
+    };
+    std::map<std::pair<int, int>, _Grid> _grids;
+
 public:
     Hdx_UnitTestDelegate(HdRenderIndex *renderIndex);
 
@@ -74,10 +115,59 @@ public:
         GfMatrix4d const &viewMatrix,
         GfMatrix4d const &projMatrix);
 
+    // Make the parameter edits since the last call visible to Sync. Once
+    // per frame, before HdEngine::Execute.
+    void PublishEdits() { _valueCache.Publish(); }
+
     // tasks
     void AddRenderTask(SdfPath const &id);
     void AddRenderSetupTask(SdfPath const &id);
 
+    // prims
+    // A non-empty instancerId makes the mesh a prototype of that instancer.
+    void AddMesh(SdfPath const &id,
+                 GfMatrix4d const &transform,
+                 VtVec3fArray const &points,
+                 VtIntArray const &numVerts,
+                 VtIntArray const &verts,
+                 SdfPath const &instancerId = SdfPath(),
+                 TfToken const &scheme = PxOsdOpenSubdivTokens->none,
+                 VtValue const &color = VtValue(GfVec3f(1, 1, 1)),
+                 HdInterpolation colorInterpolation = HdInterpolationConstant);
+
+    void AddCube(SdfPath const &id,
+                 GfMatrix4d const &transform,
+                 SdfPath const &instancerId = SdfPath(),
+                 VtValue const &color = VtValue(GfVec3f(1, 1, 1)),
+                 HdInterpolation colorInterpolation = HdInterpolationConstant);
+
+    // nx * ny quads on the unit plane (-1 ~ 1) facing +z
+    void AddGrid(SdfPath const &id,
+                 GfMatrix4d const &transform,
+                 int nx = 10, int ny = 10,
+                 SdfPath const &instancerId = SdfPath(),
+                 VtValue const &color = VtValue(GfVec3f(1, 1, 1)));
+
+    void AddTet(SdfPath const &id,
+                GfMatrix4d const &transform,
+                SdfPath const &instancerId = SdfPath(),
+                VtValue const &color = VtValue(GfVec3f(1, 1, 1)));
+
+    // instancer
+    // A non-empty parentId nests this instancer as a prototype of parentId.
+    void AddInstancer(SdfPath const &id,
+                      SdfPath const &parentId = SdfPath(),
+                      GfMatrix4f const &rootTransform = GfMatrix4f(1));
+
+    // Per instance: the index into the instancer's prototypes, in the
+    // order they were added, and the transform. Rotations are quaternions
+    // stored (real, i, j, k).
+    void SetInstancerProperties(SdfPath const &id,
+                                VtIntArray const &prototypeIndex,
+                                VtVec3fArray const &scale,
+                                VtVec4fArray const &rotate,
+                                VtVec3fArray const &translate);
+
     // delegate methods
     GfRange3d GetExtent(SdfPath const &id) override;
     GfMatrix4d GetTransform(SdfPath const &id) override;
@@ -91,6 +181,14 @@ public:
     VtValue GetCameraParamValue(
         SdfPath const &cameraId,
         TfToken const &paramName) override;
+
+    // instancing
+    SdfPath GetInstancerId(SdfPath const &primId) override;
+    VtIntArray GetInstanceIndices(
+        SdfPath const &instancerId,
+        SdfPath const &prototypeId) override;
+    GfMatrix4d GetInstancerTransform(SdfPath const &instancerId) override;
+    SdfPathVector GetInstancerPrototypes(SdfPath const &instancerId) override;
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
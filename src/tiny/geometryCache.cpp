@@ -0,0 +1,185 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//
+#include "geometryCache.h"
+#include "mesh.h"
+
+#include "pxr/base/gf/vec4d.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+void HdTinyGeometryCache::Insert(HdTinyMesh *mesh)
+{
+    _lastNeededFrame[mesh] = _frame;
+}
+
+void HdTinyGeometryCache::Remove(HdTinyMesh *mesh)
+{
+    _lastNeededFrame.erase(mesh);
+}
+
+void HdTinyGeometryCache::GetGeometryBytes(size_t *pointBytes,
+                                           size_t *normalBytes,
+                                           size_t *indexBytes) const
+{
+    *pointBytes = 0;
+    *normalBytes = 0;
+    *indexBytes = 0;
+    for (auto const &entry : _lastNeededFrame)
+    {
+        *pointBytes += entry.first->GetPointBytes();
+        *normalBytes += entry.first->GetNormalBytes();
+        *indexBytes += entry.first->GetIndexBytes();
+    }
+}
+
+void HdTinyGeometryCache::SetViewProjection(GfMatrix4d const &viewProjection)
+{
+    _viewProjection = viewProjection;
+    _hasView = true;
+}
+
+bool HdTinyGeometryCache::_IsInFrustum(HdTinyMesh const *mesh) const
+{
+    // The extent and transform are kept when the mesh is evicted. A mesh
+    // that was never synced has no bound and counts as visible.
+    GfRange3f const &extent = mesh->GetExtent();
+    if (!_hasView || extent.IsEmpty())
+    {
+        return true;
+    }
+
+    // Outside if all eight corners are beyond the same clip plane.
+    GfMatrix4d const localToClip =
+        GfMatrix4d(mesh->GetTransform()) * _viewProjection;
+    int outside[6] = {0, 0, 0, 0, 0, 0};
+    for (size_t i = 0; i < 8; ++i)
+    {
+        GfVec3f const corner = extent.GetCorner(i);
+        GfVec4d const p =
+            GfVec4d(corner[0], corner[1], corner[2], 1.0) * localToClip;
+        outside[0] += p[0] < -p[3];
+        outside[1] += p[0] > p[3];
+        outside[2] += p[1] < -p[3];
+        outside[3] += p[1] > p[3];
+        outside[4] += p[2] < -p[3];
+        outside[5] += p[2] > p[3];
+    }
+    for (int plane = 0; plane < 6; ++plane)
+    {
+        if (outside[plane] == 8)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HdTinyGeometryCache::_IsNeeded(HdTinyMesh const *mesh,
+                                    HdRprimCollection const &collection,
+                                    HdChangeTracker const &tracker) const
+{
+    // A pending visibility change is synced after this; keep the mesh
+    // until it is known.
+    if (!mesh->IsVisible() &&
+        !HdChangeTracker::IsVisibilityDirty(
+            tracker.GetRprimDirtyBits(mesh->GetId()), mesh->GetId()))
+    {
+        return false;
+    }
+
+    SdfPath const &id = mesh->GetId();
+    for (SdfPath const &excluded : collection.GetExcludePaths())
+    {
+        if (id.HasPrefix(excluded))
+        {
+            return false;
+        }
+    }
+    for (SdfPath const &root : collection.GetRootPaths())
+    {
+        if (id.HasPrefix(root))
+        {
+            return _IsInFrustum(mesh);
+        }
+    }
+    return false;
+}
+
+void HdTinyGeometryCache::Update(HdRprimCollection const &collection,
+                                 HdChangeTracker *tracker)
+{
+    ++_frame;
+
+    std::vector<std::pair<size_t, HdTinyMesh *>> evictable;
+    size_t residentBytes = 0;
+    for (auto &entry : _lastNeededFrame)
+    {
+        HdTinyMesh *mesh = entry.first;
+        if (_IsNeeded(mesh, collection, *tracker))
+        {
+            entry.second = _frame;
+            if (!mesh->IsResident())
+            {
+                // Page the geometry back in; the rprims sync next.
+                tracker->MarkRprimDirty(mesh->GetId(),
+                                        HdChangeTracker::DirtyPoints);
+            }
+        }
+
+        if (mesh->IsResident())
+        {
+            residentBytes += mesh->GetGeometryBytes();
+            if (entry.second != _frame)
+            {
+                evictable.emplace_back(entry.second, mesh);
+            }
+        }
+    }
+
+    if (_budget > 0 && residentBytes > _budget)
+    {
+        std::sort(evictable.begin(), evictable.end(),
+                  [](std::pair<size_t, HdTinyMesh *> const &a,
+                     std::pair<size_t, HdTinyMesh *> const &b) {
+                      return a.first < b.first;
+                  });
+        for (auto const &candidate : evictable)
+        {
+            if (residentBytes <= _budget)
+            {
+                break;
+            }
+            residentBytes -= candidate.second->GetGeometryBytes();
+            candidate.second->Evict();
+        }
+    }
+
+    _residentBytes = residentBytes;
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
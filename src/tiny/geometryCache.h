@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_GEOMETRY_CACHE_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_GEOMETRY_CACHE_H
+
+#include "pxr/pxr.h"
+#include "pxr/imaging/hd/changeTracker.h"
+#include "pxr/imaging/hd/rprimCollection.h"
+#include "pxr/base/gf/matrix4d.h"
+
+#include <cstddef>
+#include <unordered_map>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+class HdTinyMesh;
+
+/// \class HdTinyGeometryCache
+///
+/// Keeps the geometry held by HdTinyMesh prims under a memory budget.
+///
+/// A mesh is needed when it is in the render pass collection, visible, and
+/// its world bound intersects the view frustum of the last executed pass.
+/// Until a pass has executed, every visible mesh in the collection is
+/// needed.
+///
+/// The render pass calls Update() while tasks sync, before the rprims are
+/// synced. Needed meshes are marked as used, and evicted ones are marked
+/// dirty, so the rprim sync of the same frame pulls their geometry from the
+/// scene delegate again. If the resident geometry is over budget, meshes
+/// that are not needed are evicted, least recently needed first.
+///
+/// Meshes are registered by the render delegate on creation. All methods
+/// must be called outside of rprim Sync(), from the render thread.
+///
+class HdTinyGeometryCache
+{
+public:
+    HdTinyGeometryCache() = default;
+
+    void Insert(HdTinyMesh *mesh);
+    void Remove(HdTinyMesh *mesh);
+
+    /// Budget for resident geometry in bytes. 0 disables eviction.
+    void SetBudget(size_t bytes) { _budget = bytes; }
+    size_t GetBudget() const { return _budget; }
+
+    /// World to clip space transform of the view being drawn, used to
+    /// decide which meshes the following Update() keeps.
+    void SetViewProjection(GfMatrix4d const &viewProjection);
+
+    /// Mark the needed meshes of \p collection as used, request paging in
+    /// for the evicted ones and evict until the budget is met.
+    void Update(HdRprimCollection const &collection,
+                HdChangeTracker *tracker);
+
+    /// Resident geometry after the last Update().
+    size_t GetResidentBytes() const { return _residentBytes; }
+
+    /// Sum the geometry currently held by all meshes, by category.
+    void GetGeometryBytes(size_t *pointBytes,
+                          size_t *normalBytes,
+                          size_t *indexBytes) const;
+
+private:
+    bool _IsNeeded(HdTinyMesh const *mesh,
+                   HdRprimCollection const &collection,
+                   HdChangeTracker const &tracker) const;
+    bool _IsInFrustum(HdTinyMesh const *mesh) const;
+
+    // Mesh -> frame it was last needed in.
+    std::unordered_map<HdTinyMesh *, size_t> _lastNeededFrame;
+    GfMatrix4d _viewProjection;
+    bool _hasView = false;
+    size_t _frame = 0;
+    size_t _budget = 0;
+    size_t _residentBytes = 0;
+
+    // This class does not support copying.
+    HdTinyGeometryCache(const HdTinyGeometryCache &) = delete;
+    HdTinyGeometryCache &operator=(const HdTinyGeometryCache &) = delete;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_GEOMETRY_CACHE_H
@@ -33,11 +33,69 @@
 #include "pxr/imaging/hdx/renderTask.h"
 
 #include "renderDelegate.h"
+#include "mesh.h"
 
+#include <cmath>
 #include <iostream>
+#include <vector>
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
+// Compare the geometry held by the mesh \p id, decoded back to floats, with
+// the points authored in the scene delegate.
+static void
+CheckDecodedGeometry(HdRenderIndex *renderIndex,
+                     HdUnitTestDelegate *sceneDelegate,
+                     SdfPath const &id)
+{
+    HdTinyMesh const *mesh =
+        dynamic_cast<HdTinyMesh const *>(renderIndex->GetRprim(id));
+    if (!mesh || !mesh->IsResident())
+    {
+        TF_RUNTIME_ERROR("Mesh %s has no geometry", id.GetText());
+        return;
+    }
+
+    VtVec3fArray const authored =
+        sceneDelegate->Get(id, HdTokens->points).Get<VtVec3fArray>();
+    if (authored.size() != mesh->GetPointCount())
+    {
+        TF_RUNTIME_ERROR("Mesh %s holds %zu points, %zu were authored",
+                         id.GetText(), mesh->GetPointCount(),
+                         authored.size());
+        return;
+    }
+
+    std::vector<GfVec3f> points(mesh->GetPointCount());
+    std::vector<GfVec3f> normals(mesh->GetPointCount());
+    mesh->DecodePoints(points.data());
+    mesh->DecodeNormals(normals.data());
+
+    // Quantized positions are within half a step of the authored ones.
+    GfVec3f const tolerance = mesh->IsQuantized()
+        ? mesh->GetExtent().GetSize() / 65535.0f : GfVec3f(0.0f);
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            if (std::abs(points[i][c] - authored[i][c]) >
+                tolerance[c] + 1e-6f)
+            {
+                TF_RUNTIME_ERROR("Mesh %s point %zu decodes to (%g, %g, %g)",
+                                 id.GetText(), i, points[i][0],
+                                 points[i][1], points[i][2]);
+                return;
+            }
+        }
+        if (std::abs(normals[i].GetLength() - 1.0f) > 1e-3f)
+        {
+            TF_RUNTIME_ERROR("Mesh %s normal %zu is not unit length",
+                             id.GetText(), i);
+            return;
+        }
+    }
+}
+
 // http://graphics.pixar.com/usd/files/Siggraph2019_Hydra.pdf
 void RunHydra()
 {
@@ -87,6 +145,23 @@ void RunHydra()
     HdTaskSharedPtrVector tasks = {renderIndex->GetTask(renderTask)};
     engine.Execute(renderIndex, &tasks);
 
+    CheckDecodedGeometry(renderIndex, &sceneDelegate, SdfPath("/MyCube1"));
+
+    // Switch to the compact encoding. The setting is picked up when the
+    // frame is committed and the meshes re-sync on the frame after.
+    renderDelegate.SetRenderSetting(
+        HdTinyRenderSettingsTokens->quantizeVertices, VtValue(true));
+    engine.Execute(renderIndex, &tasks);
+    engine.Execute(renderIndex, &tasks);
+    CheckDecodedGeometry(renderIndex, &sceneDelegate, SdfPath("/MyCube1"));
+
+    // Print what the frame cost the renderer.
+    VtDictionary stats = renderDelegate.GetRenderStats();
+    for (auto const &stat : stats)
+    {
+        std::cout << "  " << stat.first << "=" << stat.second << std::endl;
+    }
+
     // Destroy the data structures
     delete renderIndex;
 }
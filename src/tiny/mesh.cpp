@@ -22,6 +22,12 @@
 // language governing permissions and limitations under the Apache License.
 //
 #include "mesh.h"
+#include "quantize.h"
+#include "renderParam.h"
+
+#include "pxr/imaging/hd/smoothNormals.h"
+#include "pxr/imaging/hd/vertexAdjacency.h"
+#include "pxr/base/tf/stopwatch.h"
 
 #include <iostream>
 
@@ -29,6 +35,7 @@ PXR_NAMESPACE_OPEN_SCOPE
 
 HdTinyMesh::HdTinyMesh(SdfPath const& id)
     : HdMesh(id)
+    , _transform(1.0f)
 {
 }
 
@@ -36,12 +43,31 @@ HdDirtyBits
 HdTinyMesh::GetInitialDirtyBitsMask() const
 {
     return HdChangeTracker::Clean
-        | HdChangeTracker::DirtyTransform;
+        | HdChangeTracker::DirtyPoints
+        | HdChangeTracker::DirtyNormals
+        | HdChangeTracker::DirtyTopology
+        | HdChangeTracker::DirtyTransform
+        | HdChangeTracker::DirtyVisibility;
 }
 
 HdDirtyBits
 HdTinyMesh::_PropagateDirtyBits(HdDirtyBits bits) const
 {
+    // Stored normals and the quantization range both depend on the points
+    // and the topology, so pull everything when either changes.
+    if (bits & (HdChangeTracker::DirtyPoints |
+                HdChangeTracker::DirtyNormals |
+                HdChangeTracker::DirtyTopology))
+    {
+        bits |= HdChangeTracker::DirtyPoints |
+                HdChangeTracker::DirtyNormals;
+    }
+
+    // An evicted mesh dropped its topology as well.
+    if (!_resident && (bits & HdChangeTracker::DirtyPoints))
+    {
+        bits |= HdChangeTracker::DirtyTopology;
+    }
     return bits;
 }
 
@@ -58,6 +84,172 @@ HdTinyMesh::Sync(HdSceneDelegate *sceneDelegate,
                    TfToken const   &reprToken)
 {
     std::cout << "* (multithreaded) Sync Tiny Mesh id=" << GetId() << std::endl;
+
+    TfStopwatch syncTimer;
+    syncTimer.Start();
+
+    SdfPath const &id = GetId();
+    HdTinyRenderParam *tinyRenderParam =
+        static_cast<HdTinyRenderParam *>(renderParam);
+
+    if (HdChangeTracker::IsTopologyDirty(*dirtyBits, id))
+    {
+        _topology = GetMeshTopology(sceneDelegate);
+    }
+
+    if (HdChangeTracker::IsTransformDirty(*dirtyBits, id))
+    {
+        _transform = GfMatrix4f(sceneDelegate->GetTransform(id));
+    }
+
+    // The geometry cache does not page in hidden meshes.
+    _UpdateVisibility(sceneDelegate, dirtyBits);
+
+    if (HdChangeTracker::IsPrimvarDirty(*dirtyBits, id, HdTokens->points))
+    {
+        VtValue value = sceneDelegate->Get(id, HdTokens->points);
+        VtVec3fArray points;
+        if (value.IsHolding<VtVec3fArray>())
+        {
+            points = value.UncheckedGet<VtVec3fArray>();
+        }
+
+        // Use authored vertex normals when there are some, otherwise
+        // compute smooth normals from the topology.
+        VtVec3fArray normals;
+        VtValue normalsValue = sceneDelegate->Get(id, HdTokens->normals);
+        if (normalsValue.IsHolding<VtVec3fArray>() &&
+            normalsValue.UncheckedGet<VtVec3fArray>().size() == points.size())
+        {
+            normals = normalsValue.UncheckedGet<VtVec3fArray>();
+        }
+        else if (!points.empty())
+        {
+            Hd_VertexAdjacency adjacency;
+            adjacency.BuildAdjacencyTable(&_topology);
+            normals = Hd_SmoothNormals::ComputeSmoothNormals(
+                &adjacency, points.size(), points.cdata());
+        }
+
+        _StoreGeometry(points, normals,
+                       tinyRenderParam && tinyRenderParam->quantizeVertices);
+    }
+
+    *dirtyBits &= ~HdChangeTracker::AllSceneDirtyBits;
+
+    syncTimer.Stop();
+    if (tinyRenderParam)
+    {
+        tinyRenderParam->syncedRprims.fetch_add(1);
+        tinyRenderParam->syncMicroseconds.fetch_add(
+            syncTimer.GetMicroseconds());
+    }
+}
+
+void
+HdTinyMesh::_StoreGeometry(VtVec3fArray const &points,
+                           VtVec3fArray const &normals,
+                           bool quantize)
+{
+    _pointCount = points.size();
+    _quantized = quantize;
+    _resident = true;
+
+    _extent = GfRange3f();
+    for (GfVec3f const &p : points)
+    {
+        _extent.UnionWith(p);
+    }
+
+    if (!quantize)
+    {
+        _points = points;
+        _normals = normals;
+        std::vector<uint16_t>().swap(_quantizedPoints);
+        std::vector<uint32_t>().swap(_encodedNormals);
+        return;
+    }
+
+    _points = VtVec3fArray();
+    _normals = VtVec3fArray();
+
+    _quantizedPoints.resize(_pointCount * 3);
+    _quantizedPoints.shrink_to_fit();
+    HdTiny_QuantizePoints(points.cdata(), _pointCount, _extent,
+                          _quantizedPoints.data());
+
+    _encodedNormals.resize(normals.size());
+    _encodedNormals.shrink_to_fit();
+    for (size_t i = 0; i < normals.size(); ++i)
+    {
+        _encodedNormals[i] = HdTiny_EncodeOctNormal(normals[i]);
+    }
+}
+
+size_t
+HdTinyMesh::GetPointBytes() const
+{
+    return _points.size() * sizeof(GfVec3f)
+        + _quantizedPoints.capacity() * sizeof(uint16_t);
+}
+
+size_t
+HdTinyMesh::GetNormalBytes() const
+{
+    return _normals.size() * sizeof(GfVec3f)
+        + _encodedNormals.capacity() * sizeof(uint32_t);
+}
+
+size_t
+HdTinyMesh::GetIndexBytes() const
+{
+    return _topology.GetFaceVertexCounts().size() * sizeof(int)
+        + _topology.GetFaceVertexIndices().size() * sizeof(int);
+}
+
+size_t
+HdTinyMesh::GetGeometryBytes() const
+{
+    return GetPointBytes() + GetNormalBytes() + GetIndexBytes();
+}
+
+void
+HdTinyMesh::Evict()
+{
+    _topology = HdMeshTopology();
+    _points = VtVec3fArray();
+    _normals = VtVec3fArray();
+    std::vector<uint16_t>().swap(_quantizedPoints);
+    std::vector<uint32_t>().swap(_encodedNormals);
+    _pointCount = 0;
+    _resident = false;
+}
+
+void
+HdTinyMesh::DecodePoints(GfVec3f *out) const
+{
+    if (_quantized)
+    {
+        HdTiny_DecodePoints(_quantizedPoints.data(), _pointCount, _extent, out);
+    }
+    else
+    {
+        std::copy(_points.cbegin(), _points.cend(), out);
+    }
+}
+
+void
+HdTinyMesh::DecodeNormals(GfVec3f *out) const
+{
+    if (_quantized)
+    {
+        HdTiny_DecodeNormals(_encodedNormals.data(), _encodedNormals.size(),
+                             out);
+    }
+    else
+    {
+        std::copy(_normals.cbegin(), _normals.cend(), out);
+    }
 }
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -26,6 +26,13 @@
 
 #include "pxr/pxr.h"
 #include "pxr/imaging/hd/mesh.h"
+#include "pxr/imaging/hd/meshTopology.h"
+#include "pxr/base/gf/matrix4f.h"
+#include "pxr/base/gf/range3f.h"
+#include "pxr/base/vt/array.h"
+
+#include <cstdint>
+#include <vector>
 
 PXR_NAMESPACE_OPEN_SCOPE
 
@@ -98,6 +105,41 @@ public:
         HdDirtyBits*     dirtyBits,
         TfToken const    &reprToken) override;
 
+    /// Number of vertices in the stored geometry.
+    size_t GetPointCount() const { return _pointCount; }
+
+    /// True if the geometry is held in the compact quantized encoding.
+    bool IsQuantized() const { return _quantized; }
+
+    /// Local-space bound of the points, used as the quantization range.
+    GfRange3f const &GetExtent() const { return _extent; }
+
+    GfMatrix4f const &GetTransform() const { return _transform; }
+    HdMeshTopology const &GetTopology() const { return _topology; }
+
+    /// False once the geometry was evicted by HdTinyGeometryCache. It is
+    /// pulled again when the points are next marked dirty.
+    bool IsResident() const { return _resident; }
+
+    /// Bytes of geometry currently held by this mesh, in total and by
+    /// category.
+    size_t GetGeometryBytes() const;
+    size_t GetPointBytes() const;
+    size_t GetNormalBytes() const;
+    size_t GetIndexBytes() const;
+
+    /// Release the geometry. Topology is dropped too, so it is re-pulled
+    /// along with the points when the mesh is paged back in.
+    void Evict();
+
+    /// Write the vertex positions into \p out, which must hold
+    /// GetPointCount() entries. Quantized positions are decoded on the fly.
+    void DecodePoints(GfVec3f *out) const;
+
+    /// Write the vertex normals into \p out, which must hold
+    /// GetPointCount() entries. Encoded normals are decoded on the fly.
+    void DecodeNormals(GfVec3f *out) const;
+
 protected:
     // Initialize the given representation of this Rprim.
     // This is called prior to syncing the prim, the first time the repr
@@ -130,6 +172,27 @@ protected:
     // This class does not support copying.
     HdTinyMesh(const HdTinyMesh&) = delete;
     HdTinyMesh &operator =(const HdTinyMesh&) = delete;
+
+private:
+    // Store points and normals, either as-is or in the compact encoding.
+    void _StoreGeometry(VtVec3fArray const &points,
+                        VtVec3fArray const &normals,
+                        bool quantize);
+
+    HdMeshTopology _topology;
+    GfMatrix4f _transform;
+    GfRange3f _extent;
+    size_t _pointCount = 0;
+    bool _quantized = false;
+    bool _resident = false;
+
+    // Full precision storage.
+    VtVec3fArray _points;
+    VtVec3fArray _normals;
+
+    // Compact storage: 3 x uint16 per point, 1 x uint32 per normal.
+    std::vector<uint16_t> _quantizedPoints;
+    std::vector<uint32_t> _encodedNormals;
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
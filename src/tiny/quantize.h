@@ -0,0 +1,153 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_QUANTIZE_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_QUANTIZE_H
+
+#include "pxr/pxr.h"
+#include "pxr/base/gf/range3f.h"
+#include "pxr/base/gf/vec3f.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+// Compact vertex encodings used by HdTinyMesh when the quantizeVertices
+// render setting is on.
+//
+// Positions are stored as three unsigned 16-bit values normalized to the
+// mesh extent (6 bytes instead of 12). Normals are octahedron-encoded into
+// two signed 16-bit values packed in one 32-bit word (4 bytes instead of 12).
+//
+// The position decoder has a fixed three-component body per point and no
+// branches, so that the compiler can vectorize it.
+
+/// Quantize \p count points to 16 bits per component, relative to \p extent.
+/// \p out must hold 3 * count values.
+inline void
+HdTiny_QuantizePoints(GfVec3f const *points, size_t count,
+                      GfRange3f const &extent, uint16_t *out)
+{
+    GfVec3f const min = extent.GetMin();
+    GfVec3f const size = extent.GetSize();
+    float scale[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        scale[c] = size[c] > 0.0f ? 65535.0f / size[c] : 0.0f;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            float const q = (points[i][c] - min[c]) * scale[c];
+            out[i * 3 + c] = static_cast<uint16_t>(
+                std::min(std::max(q + 0.5f, 0.0f), 65535.0f));
+        }
+    }
+}
+
+/// Decode \p count quantized points back to float positions.
+inline void
+HdTiny_DecodePoints(uint16_t const *in, size_t count,
+                    GfRange3f const &extent, GfVec3f *out)
+{
+    GfVec3f const min = extent.GetMin();
+    GfVec3f const step = extent.GetSize() / 65535.0f;
+
+    for (size_t i = 0; i < count; ++i, in += 3)
+    {
+        out[i] = GfVec3f(min[0] + static_cast<float>(in[0]) * step[0],
+                         min[1] + static_cast<float>(in[1]) * step[1],
+                         min[2] + static_cast<float>(in[2]) * step[2]);
+    }
+}
+
+inline float
+HdTiny_SignNotZero(float v)
+{
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+/// Octahedron-encode a unit normal into two snorm16 values.
+inline uint32_t
+HdTiny_EncodeOctNormal(GfVec3f const &n)
+{
+    float const l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+    if (l1 <= 0.0f)
+    {
+        // Degenerate normal; store +Z.
+        return 0;
+    }
+
+    float u = n[0] / l1;
+    float v = n[1] / l1;
+    if (n[2] < 0.0f)
+    {
+        float const t = u;
+        u = (1.0f - std::abs(v)) * HdTiny_SignNotZero(t);
+        v = (1.0f - std::abs(t)) * HdTiny_SignNotZero(v);
+    }
+
+    int16_t const qu = static_cast<int16_t>(
+        std::lround(std::min(std::max(u, -1.0f), 1.0f) * 32767.0f));
+    int16_t const qv = static_cast<int16_t>(
+        std::lround(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f));
+    return static_cast<uint32_t>(static_cast<uint16_t>(qu)) |
+           (static_cast<uint32_t>(static_cast<uint16_t>(qv)) << 16);
+}
+
+/// Decode an octahedron-encoded normal.
+inline GfVec3f
+HdTiny_DecodeOctNormal(uint32_t packed)
+{
+    float u = static_cast<int16_t>(packed & 0xffff) / 32767.0f;
+    float v = static_cast<int16_t>(packed >> 16) / 32767.0f;
+    float const z = 1.0f - std::abs(u) - std::abs(v);
+    if (z < 0.0f)
+    {
+        float const t = u;
+        u = (1.0f - std::abs(v)) * HdTiny_SignNotZero(t);
+        v = (1.0f - std::abs(t)) * HdTiny_SignNotZero(v);
+    }
+    GfVec3f n(u, v, z);
+    n.Normalize();
+    return n;
+}
+
+/// Decode \p count octahedron-encoded normals.
+inline void
+HdTiny_DecodeNormals(uint32_t const *in, size_t count, GfVec3f *out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = HdTiny_DecodeOctNormal(in[i]);
+    }
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_QUANTIZE_H
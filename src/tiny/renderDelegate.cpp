@@ -23,12 +23,18 @@
 //
 #include "renderDelegate.h"
 #include "mesh.h"
+#include "renderParam.h"
 #include "renderPass.h"
 
+#include "pxr/base/tf/stopwatch.h"
+
 #include <iostream>
 
 PXR_NAMESPACE_OPEN_SCOPE
 
+TF_DEFINE_PUBLIC_TOKENS(HdTinyRenderSettingsTokens, HDTINY_RENDER_SETTINGS_TOKENS);
+TF_DEFINE_PUBLIC_TOKENS(HdTinyRenderStatsTokens, HDTINY_RENDER_STATS_TOKENS);
+
 const TfTokenVector HdTinyRenderDelegate::SUPPORTED_RPRIM_TYPES =
     {
         HdPrimTypeTokens->mesh,
@@ -57,6 +63,23 @@ void HdTinyRenderDelegate::_Initialize()
 {
     std::cout << "Creating Tiny RenderDelegate" << std::endl;
     _resourceRegistry = std::make_shared<HdResourceRegistry>();
+
+    // Initialize the settings and settings descriptors.
+    _settingDescriptors.resize(2);
+    _settingDescriptors[0] = {"Quantize vertices",
+                              HdTinyRenderSettingsTokens->quantizeVertices,
+                              VtValue(false)};
+    // In megabytes; 0 keeps all geometry resident.
+    _settingDescriptors[1] = {"Geometry memory budget (MB)",
+                              HdTinyRenderSettingsTokens->geometryMemoryBudget,
+                              VtValue(0)};
+    _PopulateDefaultSettings(_settingDescriptors);
+
+    _renderParam = std::make_unique<HdTinyRenderParam>();
+    _renderParam->quantizeVertices = GetRenderSetting<bool>(
+        HdTinyRenderSettingsTokens->quantizeVertices, false);
+    _renderParam->geometryCache.SetBudget(_GetGeometryMemoryBudget());
+    _lastSettingsVersion = GetRenderSettingsVersion();
 }
 
 HdTinyRenderDelegate::~HdTinyRenderDelegate()
@@ -89,9 +112,84 @@ HdTinyRenderDelegate::GetResourceRegistry() const
     return _resourceRegistry;
 }
 
+HdRenderSettingDescriptorList
+HdTinyRenderDelegate::GetRenderSettingDescriptors() const
+{
+    return _settingDescriptors;
+}
+
 void HdTinyRenderDelegate::CommitResources(HdChangeTracker *tracker)
 {
     std::cout << "=> CommitResources RenderDelegate" << std::endl;
+
+    TfStopwatch commitTimer;
+    commitTimer.Start();
+
+    // Prims are synced right before this call; collect their counters.
+    _lastSyncedRprims = _renderParam->syncedRprims.exchange(0);
+    _lastSyncSeconds = _renderParam->syncMicroseconds.exchange(0) * 1e-6;
+
+    _UpdateRenderParam(tracker);
+
+    commitTimer.Stop();
+    _lastCommitSeconds = commitTimer.GetSeconds();
+}
+
+VtDictionary
+HdTinyRenderDelegate::GetRenderStats() const
+{
+    size_t pointBytes = 0;
+    size_t normalBytes = 0;
+    size_t indexBytes = 0;
+    _renderParam->geometryCache.GetGeometryBytes(
+        &pointBytes, &normalBytes, &indexBytes);
+
+    VtDictionary stats;
+    auto setStat = [&stats](TfToken const &key, VtValue const &value) {
+        stats[key.GetString()] = value;
+    };
+    setStat(HdTinyRenderStatsTokens->pointBytes, VtValue(pointBytes));
+    setStat(HdTinyRenderStatsTokens->normalBytes, VtValue(normalBytes));
+    setStat(HdTinyRenderStatsTokens->indexBytes, VtValue(indexBytes));
+    setStat(HdTinyRenderStatsTokens->residentBytes,
+            VtValue(pointBytes + normalBytes + indexBytes));
+    setStat(HdTinyRenderStatsTokens->syncedRprims,
+            VtValue(_lastSyncedRprims));
+    setStat(HdTinyRenderStatsTokens->syncTime, VtValue(_lastSyncSeconds));
+    setStat(HdTinyRenderStatsTokens->commitTime,
+            VtValue(_lastCommitSeconds));
+    setStat(HdTinyRenderStatsTokens->executeTime,
+            VtValue(_renderParam->executeSeconds));
+    return stats;
+}
+
+void HdTinyRenderDelegate::_UpdateRenderParam(HdChangeTracker *tracker)
+{
+    const unsigned int settingsVersion = GetRenderSettingsVersion();
+    if (_lastSettingsVersion == settingsVersion)
+    {
+        return;
+    }
+    _lastSettingsVersion = settingsVersion;
+
+    // Prims are synced before CommitResources, so the new storage mode is
+    // picked up by the re-sync on the next frame.
+    const bool quantizeVertices = GetRenderSetting<bool>(
+        HdTinyRenderSettingsTokens->quantizeVertices, false);
+    if (quantizeVertices != _renderParam->quantizeVertices)
+    {
+        _renderParam->quantizeVertices = quantizeVertices;
+        tracker->MarkAllRprimsDirty(HdChangeTracker::DirtyPoints);
+    }
+
+    _renderParam->geometryCache.SetBudget(_GetGeometryMemoryBudget());
+}
+
+size_t HdTinyRenderDelegate::_GetGeometryMemoryBudget() const
+{
+    const int megabytes = GetRenderSetting<int>(
+        HdTinyRenderSettingsTokens->geometryMemoryBudget, 0);
+    return megabytes > 0 ? size_t(megabytes) * 1024 * 1024 : 0;
 }
 
 HdRenderPassSharedPtr
@@ -115,7 +213,9 @@ HdTinyRenderDelegate::CreateRprim(TfToken const &typeId,
 
     if (typeId == HdPrimTypeTokens->mesh)
     {
-        return new HdTinyMesh(rprimId);
+        HdTinyMesh *mesh = new HdTinyMesh(rprimId);
+        _renderParam->geometryCache.Insert(mesh);
+        return mesh;
     }
     else
     {
@@ -129,6 +229,10 @@ HdTinyRenderDelegate::CreateRprim(TfToken const &typeId,
 void HdTinyRenderDelegate::DestroyRprim(HdRprim *rPrim)
 {
     std::cout << "Destroy Tiny Rprim id=" << rPrim->GetId() << std::endl;
+    if (HdTinyMesh *mesh = dynamic_cast<HdTinyMesh *>(rPrim))
+    {
+        _renderParam->geometryCache.Remove(mesh);
+    }
     delete rPrim;
 }
 
@@ -194,7 +298,7 @@ void HdTinyRenderDelegate::DestroyInstancer(HdInstancer *instancer)
 HdRenderParam *
 HdTinyRenderDelegate::GetRenderParam() const
 {
-    return nullptr;
+    return _renderParam.get();
 }
 
 PXR_NAMESPACE_CLOSE_SCOPE
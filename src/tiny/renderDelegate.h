@@ -29,8 +29,31 @@
 #include "pxr/imaging/hd/resourceRegistry.h"
 #include "pxr/base/tf/staticTokens.h"
 
+#include <memory>
+
 PXR_NAMESPACE_OPEN_SCOPE
 
+class HdTinyRenderParam;
+
+#define HDTINY_RENDER_SETTINGS_TOKENS \
+    (quantizeVertices)                \
+    (geometryMemoryBudget)
+
+TF_DECLARE_PUBLIC_TOKENS(HdTinyRenderSettingsTokens, HDTINY_RENDER_SETTINGS_TOKENS);
+
+// Keys of the dictionary returned by HdTinyRenderDelegate::GetRenderStats().
+#define HDTINY_RENDER_STATS_TOKENS \
+    (pointBytes)                   \
+    (normalBytes)                  \
+    (indexBytes)                   \
+    (residentBytes)                \
+    (syncedRprims)                 \
+    (syncTime)                     \
+    (commitTime)                   \
+    (executeTime)
+
+TF_DECLARE_PUBLIC_TOKENS(HdTinyRenderStatsTokens, HDTINY_RENDER_STATS_TOKENS);
+
 ///
 /// \class HdTinyRenderDelegate
 ///
@@ -86,6 +109,17 @@ public:
 
     HdRenderParam *GetRenderParam() const override;
 
+    /// Returns a list of user-configurable render settings.
+    /// This is a reflection API for the render settings dictionary; it need
+    /// not be exhaustive, but can be used for populating application
+    /// settings UI.
+    HdRenderSettingDescriptorList GetRenderSettingDescriptors() const override;
+
+    /// Returns renderer statistics for the last frame. Geometry sizes are
+    /// in bytes, times in seconds. syncTime is the Sync() time of all
+    /// synced rprims summed across worker threads.
+    VtDictionary GetRenderStats() const override;
+
 private:
     static const TfTokenVector SUPPORTED_RPRIM_TYPES;
     static const TfTokenVector SUPPORTED_SPRIM_TYPES;
@@ -93,8 +127,28 @@ private:
 
     void _Initialize();
 
+    // Push render setting changes to the render param, and dirty any prims
+    // whose stored data depends on them.
+    void _UpdateRenderParam(HdChangeTracker *tracker);
+
+    // The geometryMemoryBudget render setting in bytes.
+    size_t _GetGeometryMemoryBudget() const;
+
     HdResourceRegistrySharedPtr _resourceRegistry;
 
+    // A list of render setting exports.
+    HdRenderSettingDescriptorList _settingDescriptors;
+
+    // Counters of the last frame, collected in CommitResources.
+    size_t _lastSyncedRprims = 0;
+    double _lastSyncSeconds = 0.0;
+    double _lastCommitSeconds = 0.0;
+
+    // The render settings version the render param was last updated for.
+    unsigned int _lastSettingsVersion = 0;
+
+    std::unique_ptr<HdTinyRenderParam> _renderParam;
+
     // This class does not support copying.
     HdTinyRenderDelegate(const HdTinyRenderDelegate &) = delete;
     HdTinyRenderDelegate &operator=(const HdTinyRenderDelegate &) = delete;
@@ -0,0 +1,73 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDER_PARAM_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDER_PARAM_H
+
+#include "pxr/pxr.h"
+#include "pxr/imaging/hd/renderDelegate.h"
+#include "geometryCache.h"
+
+#include <atomic>
+#include <cstdint>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+///
+/// \class HdTinyRenderParam
+///
+/// The render delegate can create an object of type HdRenderParam, to pass
+/// to each prim during Sync(). HdTiny uses this class to pass the render
+/// settings that change how prims store their data, and to share the
+/// geometry cache with the render pass.
+///
+/// The settings are written by the render delegate outside of Sync() and
+/// only read by prims, so no locking is needed. The sync counters are
+/// updated by prims from worker threads and are atomic.
+///
+class HdTinyRenderParam final : public HdRenderParam
+{
+public:
+    HdTinyRenderParam() = default;
+    ~HdTinyRenderParam() override = default;
+
+    /// Store positions as 16-bit values relative to the mesh extent and
+    /// normals octahedron-encoded in 32 bits.
+    bool quantizeVertices = false;
+
+    /// Resident geometry of all meshes, under the geometryMemoryBudget
+    /// render setting.
+    HdTinyGeometryCache geometryCache;
+
+    /// Rprims synced, and their summed Sync() time, since the last
+    /// CommitResources().
+    std::atomic<size_t> syncedRprims{0};
+    std::atomic<int64_t> syncMicroseconds{0};
+
+    /// Time spent in the last render pass execution.
+    double executeSeconds = 0.0;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDER_PARAM_H
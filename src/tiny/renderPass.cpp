@@ -22,6 +22,13 @@
 // language governing permissions and limitations under the Apache License.
 //
 #include "renderPass.h"
+#include "renderParam.h"
+
+#include "pxr/imaging/hd/camera.h"
+#include "pxr/imaging/hd/renderDelegate.h"
+#include "pxr/imaging/hd/renderIndex.h"
+#include "pxr/imaging/hd/renderPassState.h"
+#include "pxr/base/tf/stopwatch.h"
 
 #include <iostream>
 
@@ -39,12 +46,79 @@ HdTinyRenderPass::~HdTinyRenderPass()
     std::cout << "Destroying renderPass" << std::endl;
 }
 
+void
+HdTinyRenderPass::_Sync()
+{
+    HdRenderIndex *renderIndex = GetRenderIndex();
+    HdTinyRenderParam *renderParam = static_cast<HdTinyRenderParam *>(
+        renderIndex->GetRenderDelegate()->GetRenderParam());
+
+    // Sprims sync before tasks, so the camera already has this frame's
+    // transform and projection.
+    GfMatrix4d viewProjection;
+    if (_ComputeViewProjection(&viewProjection))
+    {
+        renderParam->geometryCache.SetViewProjection(viewProjection);
+    }
+
+    // Evicted meshes this pass needs are marked dirty here so that the
+    // rprim sync of this frame pulls them in before the pass executes.
+    renderParam->geometryCache.Update(GetRprimCollection(),
+                                      &renderIndex->GetChangeTracker());
+}
+
 void
 HdTinyRenderPass::_Execute(
     HdRenderPassStateSharedPtr const& renderPassState,
     TfTokenVector const &renderTags)
 {
     std::cout << "=> Execute RenderPass" << std::endl;
+
+    TfStopwatch executeTimer;
+    executeTimer.Start();
+
+    HdRenderIndex *renderIndex = GetRenderIndex();
+    HdTinyRenderParam *renderParam = static_cast<HdTinyRenderParam *>(
+        renderIndex->GetRenderDelegate()->GetRenderParam());
+
+    // Remember the camera and its framing for the next _Sync. Without a
+    // camera the state's matrices are the best there is, a frame late.
+    if (HdCamera const *camera = renderPassState->GetCamera())
+    {
+        GfVec4f const &viewport = renderPassState->GetViewport();
+        _cameraId = camera->GetId();
+        _windowPolicy = renderPassState->GetWindowPolicy();
+        _aspectRatio = viewport[3] != 0.0f ? viewport[2] / viewport[3] : 1.0;
+    }
+    else
+    {
+        _cameraId = SdfPath();
+        renderParam->geometryCache.SetViewProjection(
+            renderPassState->GetWorldToViewMatrix() *
+            renderPassState->GetProjectionMatrix());
+    }
+
+    executeTimer.Stop();
+    renderParam->executeSeconds = executeTimer.GetSeconds();
+}
+
+bool
+HdTinyRenderPass::_ComputeViewProjection(GfMatrix4d *viewProjection) const
+{
+    if (_cameraId.IsEmpty())
+    {
+        return false;
+    }
+    HdCamera const *camera = static_cast<HdCamera const *>(
+        GetRenderIndex()->GetSprim(HdPrimTypeTokens->camera, _cameraId));
+    if (!camera)
+    {
+        return false;
+    }
+    *viewProjection = camera->GetTransform().GetInverse() *
+        CameraUtilConformedWindow(camera->ComputeProjectionMatrix(),
+                                  _windowPolicy, _aspectRatio);
+    return true;
 }
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -26,6 +26,9 @@
 
 #include "pxr/pxr.h"
 #include "pxr/imaging/hd/renderPass.h"
+#include "pxr/imaging/cameraUtil/conformWindow.h"
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/usd/sdf/path.h"
 
 PXR_NAMESPACE_OPEN_SCOPE
 
@@ -49,6 +52,10 @@ public:
 
 protected:
 
+    /// Called while tasks sync, before the rprims are synced: page in the
+    /// geometry this pass needs and evict over the memory budget.
+    void _Sync() override;
+
     /// Draw the scene with the bound renderpass state.
     ///   \param renderPassState Input parameters (including viewer parameters)
     ///                          for this renderpass.
@@ -57,6 +64,16 @@ protected:
         HdRenderPassStateSharedPtr const& renderPassState,
         TfTokenVector const &renderTags) override;
 
+private:
+    // The view-projection of the pass's camera as the render index has it
+    // now. False when the camera is not known yet.
+    bool _ComputeViewProjection(GfMatrix4d *viewProjection) const;
+
+    // How the last _Execute framed its camera, so that _Sync can rebuild
+    // the frustum before the render pass state is prepared.
+    SdfPath _cameraId;
+    CameraUtilConformWindowPolicy _windowPolicy = CameraUtilFit;
+    double _aspectRatio = 1.0;
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -8,43 +8,93 @@ public:
 
 	TinySceneDelegate(pxr::HdRenderIndex* parentindex, pxr::SdfPath const& id) :pxr::HdSceneDelegate(parentindex, id) {};
 
+	// Called from Hydra's parallel sync; only reads the store.
 	pxr::GfMatrix4d GetTransform(pxr::SdfPath const& id) override
 	{
-		if (_meshes.find(id) != _meshes.end()) {
-			return pxr::GfMatrix4d(_meshes[id].transform);
+		auto it = _meshIndices.find(id);
+		if (it != _meshIndices.end()) {
+			return pxr::GfMatrix4d(_transforms[it->second]);
 		}
 
 		return pxr::GfMatrix4d(1);
 	}
 
 	void setTime(unsigned int time) {
-		pxr::SdfPath id1("/Cube1");
-		GetRenderIndex().GetChangeTracker().MarkRprimDirty(id1, pxr::HdChangeTracker::DirtyTransform);
+		// Each animated mesh is addressed by its own slot in the store.
+		std::vector<size_t> indices;
+		std::vector<pxr::GfMatrix4f> matrices;
+		indices.reserve(_spins.size());
+		matrices.reserve(_spins.size());
+		for (Spin const& spin : _spins) {
+			auto it = _meshIndices.find(spin.id);
+			if (!TF_VERIFY(it != _meshIndices.end())) {
+				continue;
+			}
+			indices.push_back(it->second);
+			matrices.push_back(pxr::GfMatrix4f().SetRotate(pxr::GfRotation(spin.axis, spin.degreesPerFrame * time)));
+		}
+		SetTransforms(indices, matrices);
 	}
 
-	void AddMesh(pxr::SdfPath& id) {
+	// Bulk transform update, by the indices returned from AddMesh.
+	// Only the meshes whose matrix actually changed are marked dirty.
+	// Must not be called while Hydra is syncing.
+	void SetTransforms(pxr::TfSpan<const size_t> indices, pxr::TfSpan<const pxr::GfMatrix4f> matrices) {
+		if (!TF_VERIFY(indices.size() == matrices.size())) {
+			return;
+		}
+
+		pxr::HdChangeTracker& tracker = GetRenderIndex().GetChangeTracker();
+		for (size_t i = 0; i < indices.size(); ++i) {
+			size_t index = indices[i];
+			if (!TF_VERIFY(index < _transforms.size())) {
+				continue;
+			}
+			if (_transforms[index] == matrices[i]) {
+				continue;
+			}
+			_transforms[index] = matrices[i];
+			tracker.MarkRprimDirty(_meshIds[index], pxr::HdChangeTracker::DirtyTransform);
+		}
+	}
+
+	// Returns the index used to address the mesh in SetTransforms.
+	size_t AddMesh(pxr::SdfPath const& id) {
 		pxr::HdRenderIndex& index = GetRenderIndex();
 		index.InsertRprim(pxr::HdPrimTypeTokens->mesh, this, id);
-		_meshes[id] = _Mesh();
+
+		size_t meshIndex = _meshIds.size();
+		_meshIds.push_back(id);
+		_transforms.push_back(pxr::GfMatrix4f(1));
+		_meshIndices[id] = meshIndex;
+		return meshIndex;
 	}
 
 	void Populate() {
 
 		pxr::SdfPath id1("/Cube1");
 		AddMesh(id1);
+		_spins.push_back({ id1, pxr::GfVec3d(0, 1, 0), 10.0 });
 
 
 		pxr::SdfPath id2("/Cube2");
 		AddMesh(id2);
+		_spins.push_back({ id2, pxr::GfVec3d(1, 0, 0), 5.0 });
 
 	};
 
-	struct _Mesh {
-		_Mesh() { }
-		pxr::GfMatrix4f transform;
+	// Meshes setTime() rotates about an axis.
+	struct Spin {
+		pxr::SdfPath id;
+		pxr::GfVec3d axis;
+		double degreesPerFrame;
 	};
+	std::vector<Spin> _spins;
 
-	std::map<pxr::SdfPath, _Mesh> _meshes;
+	// Dense mesh store: one entry per mesh, addressed by index.
+	std::vector<pxr::SdfPath> _meshIds;
+	std::vector<pxr::GfMatrix4f> _transforms;
+	pxr::TfHashMap<pxr::SdfPath, size_t, pxr::SdfPath::Hash> _meshIndices;
 };
 
 class TinyRenderDelegate_Mesh final : public pxr::HdMesh
@@ -62,13 +112,15 @@ public:
 		pxr::SdfPath const& id = GetId();
 
 		if (pxr::HdChangeTracker::IsTransformDirty(*dirtyBits, id)) {
-			delegate->GetTransform(id);
+			_transform = delegate->GetTransform(id);
 			std::cout << "pulling new transform -> " << id << std::endl;
 		}
 
 		*dirtyBits &= ~pxr::HdChangeTracker::AllSceneDirtyBits;
 	}
 
+	pxr::GfMatrix4d const& GetTransform() const { return _transform; }
+
 	pxr::HdDirtyBits _PropagateDirtyBits(pxr::HdDirtyBits bits) const override {
 		return bits;
 	}
@@ -82,6 +134,9 @@ public:
 			_reprs.emplace_back(reprToken, pxr::HdReprSharedPtr());
 		}
 	};
+
+private:
+	pxr::GfMatrix4d _transform = pxr::GfMatrix4d(1);
 };
 
 class TinyRenderDelegate_RenderPass final : public pxr::HdRenderPass
@@ -89,10 +144,65 @@ class TinyRenderDelegate_RenderPass final : public pxr::HdRenderPass
 public:
 	TinyRenderDelegate_RenderPass(pxr::HdRenderIndex *index, pxr::HdRprimCollection const& collection) :pxr::HdRenderPass(index, collection) {  }
 
+	// The scene as seen by one frame. Captured after Sync, so the pass can
+	// execute while the next frame syncs the rprims.
+	struct Snapshot {
+		std::vector<pxr::SdfPath> ids;
+		std::vector<pxr::GfMatrix4d> transforms;
+	};
+
+	void CaptureSnapshot() {
+		_snapshot.ids.clear();
+		_snapshot.transforms.clear();
+		pxr::HdRenderIndex* index = GetRenderIndex();
+		for (pxr::SdfPath const& id : index->GetRprimIds()) {
+			if (auto mesh = dynamic_cast<const TinyRenderDelegate_Mesh*>(index->GetRprim(id))) {
+				_snapshot.ids.push_back(id);
+				_snapshot.transforms.push_back(mesh->GetTransform());
+			}
+		}
+	}
+
+	// Reads only the snapshot, never the rprims.
 	void _Execute(pxr::HdRenderPassStateSharedPtr const &renderPassState, pxr::TfTokenVector const &renderTags) {
-		std::cout << "(1) Generating image" << std::endl;
+		std::cout << "(1) Generating image (" << _snapshot.ids.size() << " meshes)" << std::endl;
+
+		// No real rasterizer here: write an HDR gradient so the
+		// post-process tasks have a linear image to work on.
+		_color.resize(size_t(_width) * _height);
+		pxr::GfVec4f* color = _color.data();
+		for (int y = 0; y < _height; ++y) {
+			for (int x = 0; x < _width; ++x) {
+				color[y * _width + x] = pxr::GfVec4f(8.0f * x / _width, 8.0f * y / _height, 0.18f, 1.0f);
+			}
+		}
 	};
 
+	int GetWidth() const { return _width; }
+	int GetHeight() const { return _height; }
+	pxr::VtVec4fArray const& GetColor() const { return _color; }
+
+private:
+	int _width = 640;
+	int _height = 480;
+	// linear RGBA
+	pxr::VtVec4fArray _color;
+	Snapshot _snapshot;
+};
+
+// HdTaskContext keys the tasks below exchange images through, in addition
+// to HdAovTokens->color (linear RGBA, VtVec4fArray).
+struct TinyTaskContextTokens {
+	// GfVec2i, width and height of the color AOV
+	static pxr::TfToken const& colorDimensions() {
+		static const pxr::TfToken token("colorDimensions");
+		return token;
+	}
+	// VtUIntArray, display-referred RGBA8 packed as 0xAABBGGRR
+	static pxr::TfToken const& colorLdr() {
+		static const pxr::TfToken token("colorLdr");
+		return token;
+	}
 };
 
 
@@ -147,13 +257,37 @@ public:
 };
 
 
+// Renders with two render passes and states, used on alternate frames.
+//
+// When pipelined, Execute() of frame N snapshots the synced scene and
+// starts rendering it in the background, then returns. HdEngine::Execute of
+// frame N+1 syncs the rprims on worker threads while frame N renders. Its
+// Execute() waits for frame N, hands frame N's color to the following
+// tasks and starts frame N+1. Output lags one frame behind, and a frame
+// costs max(Sync, Execute) instead of Sync + Execute.
+//
+// When not pipelined, each frame renders synchronously, as before.
 class TinyRenderTask final : public pxr::HdTask {
 public:
-	TinyRenderTask(pxr::HdRenderPassSharedPtr renderPass, pxr::HdRenderPassStateSharedPtr renderPassState, pxr::HdRenderIndex *index)
-		:pxr::HdTask(pxr::SdfPath::AbsoluteRootPath()), _renderPass(renderPass), _renderPassState(renderPassState), _index(index) {};
+	TinyRenderTask(pxr::HdRenderIndex *index, pxr::HdRprimCollection const& collection)
+		:pxr::HdTask(pxr::SdfPath::AbsoluteRootPath()), _index(index) {
+		pxr::HdRenderDelegate* renderDelegate = index->GetRenderDelegate();
+		for (int i = 0; i < 2; ++i) {
+			_renderPasses[i] = renderDelegate->CreateRenderPass(index, collection);
+			_renderPassStates[i] = renderDelegate->CreateRenderPassState();
+		}
+	};
+
+	~TinyRenderTask() {
+		_dispatcher.Wait();
+	}
+
+	void SetPipelined(bool pipelined) { _pipelined = pipelined; }
 
 	virtual void Sync(pxr::HdSceneDelegate* delegate, pxr::HdTaskContext* ctx, pxr::HdDirtyBits* dirtyBits) override {
-		_renderPass->Sync();
+		// The other pass may still be rendering the previous frame; only
+		// touch the one this frame will use.
+		_renderPasses[_current]->Sync();
 	};
 
 	virtual void Prepare(pxr::HdTaskContext* ctx, pxr::HdRenderIndex* renderIndex) override {
@@ -162,19 +296,88 @@ public:
 
 	void Execute(pxr::HdTaskContext* ctx) override
 	{
-		_renderPass->Execute(_renderPassState, pxr::TfTokenVector());
+		// Finish the frame in flight; it used the other pass.
+		_dispatcher.Wait();
+		const int previous = 1 - _current;
+		const bool previousReady = _inFlight;
+		_inFlight = false;
+
+		auto pass = _GetPass(_current);
+		pass->CaptureSnapshot();
+
+		if (_pipelined) {
+			pxr::HdRenderPassSharedPtr renderPass = _renderPasses[_current];
+			pxr::HdRenderPassStateSharedPtr renderPassState = _renderPassStates[_current];
+			_dispatcher.Run([renderPass, renderPassState]() {
+				renderPass->Execute(renderPassState, pxr::TfTokenVector());
+			});
+			_inFlight = true;
+
+			if (previousReady) {
+				_Publish(ctx, _GetPass(previous));
+			}
+			else {
+				_Unpublish(ctx);
+			}
+		}
+		else {
+			_renderPasses[_current]->Execute(_renderPassStates[_current], pxr::TfTokenVector());
+			_Publish(ctx, pass);
+		}
+
+		_current = 1 - _current;
 	};
 
-	pxr::HdRenderPassSharedPtr _renderPass;
-	pxr::HdRenderPassStateSharedPtr _renderPassState;
+private:
+	TinyRenderDelegate_RenderPass* _GetPass(int i) const {
+		return static_cast<TinyRenderDelegate_RenderPass*>(_renderPasses[i].get());
+	}
+
+	// Hand the color AOV to the following tasks.
+	static void _Publish(pxr::HdTaskContext* ctx, TinyRenderDelegate_RenderPass* pass) {
+		(*ctx)[pxr::HdAovTokens->color] = pxr::VtValue(pass->GetColor());
+		(*ctx)[TinyTaskContextTokens::colorDimensions()] = pxr::VtValue(pxr::GfVec2i(pass->GetWidth(), pass->GetHeight()));
+	}
+
+	// Nothing has been rendered yet: also drop the previous display image,
+	// so nothing downstream tonemaps or shows a stale frame.
+	static void _Unpublish(pxr::HdTaskContext* ctx) {
+		ctx->erase(pxr::HdAovTokens->color);
+		ctx->erase(TinyTaskContextTokens::colorDimensions());
+		ctx->erase(TinyTaskContextTokens::colorLdr());
+	}
+
+	pxr::HdRenderPassSharedPtr _renderPasses[2];
+	pxr::HdRenderPassStateSharedPtr _renderPassStates[2];
 	pxr::HdRenderIndex *_index;
+	pxr::WorkDispatcher _dispatcher;
+	int _current = 0;
+	bool _inFlight = false;
+	bool _pipelined = false;
 };
 
+// Reads the linear color AOV and writes the RGBA8 display image.
+//
+// Exposure, filmic tonemapping and sRGB encoding are baked into one 3D LUT.
+// The LUT is indexed through a log2 shaper, because linear HDR values are
+// spread over many stops. Each pixel is read once, mapped through the LUT
+// and quantized to 8 bits in the same pass, and rows run in parallel.
 class TinyColorCorrectionTask final : public pxr::HdTask {
 public:
 	TinyColorCorrectionTask() :pxr::HdTask(pxr::SdfPath::AbsoluteRootPath()) {};
 
+	void SetExposure(float exposure) {
+		if (exposure != _exposure) {
+			_exposure = exposure;
+			_lutDirty = true;
+		}
+	}
+
 	virtual void Sync(pxr::HdSceneDelegate* delegate, pxr::HdTaskContext* ctx, pxr::HdDirtyBits* dirtyBits) override {
+		if (_lutDirty) {
+			_BuildLut();
+			_lutDirty = false;
+		}
 	};
 
 	virtual void Prepare(pxr::HdTaskContext* ctx, pxr::HdRenderIndex* renderIndex) override {
@@ -182,7 +385,111 @@ public:
 
 	void Execute(pxr::HdTaskContext* ctx) override {
 		std::cout << "(2) Color correcting the image" << std::endl;
+
+		pxr::VtVec4fArray color;
+		pxr::GfVec2i dimensions;
+		if (!_GetTaskContextData(ctx, pxr::HdAovTokens->color, &color) ||
+			!_GetTaskContextData(ctx, TinyTaskContextTokens::colorDimensions(), &dimensions)) {
+			ctx->erase(TinyTaskContextTokens::colorLdr());
+			return;
+		}
+		const size_t width = dimensions[0];
+		const size_t height = dimensions[1];
+		if (!TF_VERIFY(color.size() == width * height)) {
+			return;
+		}
+
+		pxr::VtUIntArray ldr(width * height);
+		const pxr::GfVec4f* src = color.cdata();
+		uint32_t* dst = ldr.data();
+		pxr::WorkParallelForN(height, [this, src, dst, width](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; ++y) {
+				_ApplyRow(src + y * width, dst + y * width, width);
+			}
+		});
+
+		(*ctx)[TinyTaskContextTokens::colorLdr()] = pxr::VtValue(ldr);
+	}
+
+private:
+	static constexpr int LUT_SIZE = 33;
+	// shaper range in stops
+	static constexpr float LOG_MIN = -12.0f;
+	static constexpr float LOG_MAX = 8.0f;
+
+	static float _ToShaper(float linear) {
+		const float stops = std::log2(std::max(linear, 1e-8f));
+		const float t = (stops - LOG_MIN) / (LOG_MAX - LOG_MIN);
+		return std::min(std::max(t, 0.0f), 1.0f) * (LUT_SIZE - 1);
+	}
+
+	// ACES filmic fit by Krzysztof Narkowicz.
+	static float _Filmic(float x) {
+		const float y = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+		return std::min(std::max(y, 0.0f), 1.0f);
+	}
+
+	static float _SrgbEncode(float x) {
+		return x <= 0.0031308f ? 12.92f * x : 1.055f * std::pow(x, 1.0f / 2.4f) - 0.055f;
 	}
+
+	void _BuildLut() {
+		const float scale = std::exp2(_exposure);
+		float shaper[LUT_SIZE];
+		for (int i = 0; i < LUT_SIZE; ++i) {
+			const float stops = LOG_MIN + (LOG_MAX - LOG_MIN) * i / (LUT_SIZE - 1);
+			shaper[i] = _SrgbEncode(_Filmic(std::exp2(stops) * scale));
+		}
+
+		// The current grade is separable, but a 3D LUT leaves room for
+		// cross-channel looks without changing the per-pixel path.
+		_lut.resize(LUT_SIZE * LUT_SIZE * LUT_SIZE);
+		for (int b = 0; b < LUT_SIZE; ++b) {
+			for (int g = 0; g < LUT_SIZE; ++g) {
+				for (int r = 0; r < LUT_SIZE; ++r) {
+					_lut[(b * LUT_SIZE + g) * LUT_SIZE + r] = pxr::GfVec3f(shaper[r], shaper[g], shaper[b]);
+				}
+			}
+		}
+	}
+
+	static uint32_t _Quantize(float v) {
+		return static_cast<uint32_t>(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	void _ApplyRow(const pxr::GfVec4f* src, uint32_t* dst, size_t width) const {
+		const pxr::GfVec3f* lut = _lut.data();
+		for (size_t x = 0; x < width; ++x) {
+			const pxr::GfVec4f& c = src[x];
+			const float fr = _ToShaper(c[0]);
+			const float fg = _ToShaper(c[1]);
+			const float fb = _ToShaper(c[2]);
+			const int r0 = std::min(int(fr), LUT_SIZE - 2);
+			const int g0 = std::min(int(fg), LUT_SIZE - 2);
+			const int b0 = std::min(int(fb), LUT_SIZE - 2);
+			const float tr = fr - r0;
+			const float tg = fg - g0;
+			const float tb = fb - b0;
+
+			// trilinear
+			const pxr::GfVec3f* p = lut + (b0 * LUT_SIZE + g0) * LUT_SIZE + r0;
+			const int dg = LUT_SIZE;
+			const int db = LUT_SIZE * LUT_SIZE;
+			const pxr::GfVec3f c00 = p[0] + (p[1] - p[0]) * tr;
+			const pxr::GfVec3f c10 = p[dg] + (p[dg + 1] - p[dg]) * tr;
+			const pxr::GfVec3f c01 = p[db] + (p[db + 1] - p[db]) * tr;
+			const pxr::GfVec3f c11 = p[db + dg] + (p[db + dg + 1] - p[db + dg]) * tr;
+			const pxr::GfVec3f c0 = c00 + (c10 - c00) * tg;
+			const pxr::GfVec3f c1 = c01 + (c11 - c01) * tg;
+			const pxr::GfVec3f out = c0 + (c1 - c0) * tb;
+
+			dst[x] = _Quantize(out[0]) | (_Quantize(out[1]) << 8) | (_Quantize(out[2]) << 16) | (_Quantize(c[3]) << 24);
+		}
+	}
+
+	float _exposure = 0.0f;
+	bool _lutDirty = true;
+	std::vector<pxr::GfVec3f> _lut;
 };
 
 int main() {
@@ -193,9 +500,7 @@ int main() {
 
 
 	pxr::HdRprimCollection collection(pxr::TfToken("testCollection"), pxr::HdReprSelector(pxr::HdReprTokens->hull));
-	pxr::HdRenderPassSharedPtr renderPass(renderDelegate.CreateRenderPass(renderIndex, collection));
-	pxr::HdRenderPassStateSharedPtr renderPassState(renderDelegate.CreateRenderPassState());
-	pxr::HdTaskSharedPtr taskRender(new TinyRenderTask(renderPass, renderPassState, renderIndex));
+	std::shared_ptr<TinyRenderTask> taskRender(new TinyRenderTask(renderIndex, collection));
 	pxr::HdTaskSharedPtr taskColorCorrect(new TinyColorCorrectionTask());
 	pxr::HdTaskSharedPtrVector tasks = { taskRender,taskColorCorrect };
 
@@ -203,12 +508,28 @@ int main() {
 	sceneDelegate.Populate();
 	z.Execute(renderIndex, &tasks);
 
+	pxr::VtValue ldr;
+	if (z.GetTaskContextData(TinyTaskContextTokens::colorLdr(), &ldr)) {
+		std::cout << "color corrected " << ldr.GetArraySize() << " pixels" << std::endl;
+	}
+
 	std::cout << "" << std::endl;
 
-	sceneDelegate.setTime(2);
+	// Animated playback: frame N+1 syncs while frame N renders.
+	const unsigned int frameCount = 10;
+	pxr::TfStopwatch playback;
+	playback.Start();
+	taskRender->SetPipelined(true);
+	for (unsigned int frame = 1; frame <= frameCount; ++frame) {
+		sceneDelegate.setTime(frame);
+		z.Execute(renderIndex, &tasks);
+	}
+	// The last frame renders synchronously, which drains the pipeline.
+	taskRender->SetPipelined(false);
+	sceneDelegate.setTime(frameCount + 1);
 	z.Execute(renderIndex, &tasks);
-
-
+	playback.Stop();
+	std::cout << "played " << frameCount + 1 << " frames in " << playback.GetSeconds() << "s" << std::endl;
 
 	return 0;
 }
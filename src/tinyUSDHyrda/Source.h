@@ -6,6 +6,20 @@
 #include "pxr\imaging\hd\task.h"
 #include "pxr\imaging\hd\renderPass.h"
 #include "pxr\imaging\hd\renderPassState.h"
+#include "pxr\imaging\hd\aov.h"
 #include "pxr\base\gf\matrix4f.h"
+#include "pxr\base\gf\vec2i.h"
+#include "pxr\base\gf\vec3f.h"
+#include "pxr\base\gf\vec4f.h"
+#include "pxr\base\vt\types.h"
+#include "pxr\base\work\dispatcher.h"
+#include "pxr\base\work\loops.h"
+#include "pxr\base\tf\stopwatch.h"
+#include "pxr\base\gf\rotation.h"
+#include "pxr\base\tf\hashmap.h"
+#include "pxr\base\tf\span.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <vector>
 #include <fstream>
\ No newline at end of file